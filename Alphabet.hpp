@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// The tree, the grids and the finders work on symbols: dense letter ids 0..MaxSymbols-1, stored
+// one byte each as char('a' + symbol). Lowercase ASCII is its own encoding, so the plain a-z API
+// needs no conversion; anything else goes through an Alphabet once, when words and boards come in.
+// Children are indexed by a 64-bit mask, which caps the alphabet size.
+constexpr int MaxSymbols = 64;
+
+inline int Symbol(char c)
+{
+    return uint8_t(c) - 97;
+}
+
+inline char SymbolChar(int symbol)
+{
+    return char(97 + symbol);
+}
+
+// True for the bytes that encode a symbol, 'a' up to 'a' + MaxSymbols - 1.
+inline bool IsSymbol(char c)
+{
+    return unsigned(Symbol(c)) < unsigned(MaxSymbols);
+}
+
+// The plain API takes words and boards as they are: the per-symbol tables have no room for other
+// bytes. Words with them are skipped by the builds, boards with them rejected by CheckBoard.
+inline bool IsSymbols(string_view text)
+{
+    return all_of(text.begin(), text.end(), IsSymbol);
+}
+
+// Throws if a cell is not a symbol, e.g. an uppercase letter that didn't go through an Alphabet.
+inline void CheckBoard(const vector<vector<char>>& board)
+{
+    for (const auto& row : board)
+    {
+        if (!all_of(row.begin(), row.end(), IsSymbol))
+        {
+            throw runtime_error("board letter outside the alphabet");
+        }
+    }
+}
+
+// Decodes the code point at text[i] and moves i past it. Returns -1 for malformed UTF-8.
+inline int32_t DecodeUtf8(string_view text, size_t& i)
+{
+    const uint8_t lead = uint8_t(text[i++]);
+    if (lead < 0x80)
+    {
+        return lead;
+    }
+    int extra = lead >= 0xf0 ? 3 : lead >= 0xe0 ? 2 : lead >= 0xc0 ? 1 : -1;
+    if (extra < 0 || lead > 0xf4 || i + extra > text.size())
+    {
+        return -1;
+    }
+    int32_t code_point = lead & (0x3f >> extra);
+    for (; extra > 0; --extra)
+    {
+        const uint8_t next = uint8_t(text[i++]);
+        if ((next & 0xc0) != 0x80)
+        {
+            return -1;
+        }
+        code_point = (code_point << 6) | (next & 0x3f);
+    }
+    return code_point;
+}
+
+inline void AppendUtf8(int32_t code_point, string& out)
+{
+    if (code_point < 0x80)
+    {
+        out += char(code_point);
+    }
+    else if (code_point < 0x800)
+    {
+        out += char(0xc0 | (code_point >> 6));
+        out += char(0x80 | (code_point & 0x3f));
+    }
+    else if (code_point < 0x10000)
+    {
+        out += char(0xe0 | (code_point >> 12));
+        out += char(0x80 | ((code_point >> 6) & 0x3f));
+        out += char(0x80 | (code_point & 0x3f));
+    }
+    else
+    {
+        out += char(0xf0 | (code_point >> 18));
+        out += char(0x80 | ((code_point >> 12) & 0x3f));
+        out += char(0x80 | ((code_point >> 6) & 0x3f));
+        out += char(0x80 | (code_point & 0x3f));
+    }
+}
+
+// Maps the letters of a dictionary, as Unicode code points, to symbols in code point order: a
+// dictionary that uses all of a-z gets the identity mapping. Letters are taken as they are, there
+// is no case folding or normalization.
+class Alphabet
+{
+public:
+    Alphabet() = default;
+
+    // The letters of the UTF-8 words. Throws if there are more than MaxSymbols of them or a word
+    // is not valid UTF-8.
+    explicit Alphabet(const vector<string>& words)
+    {
+        vector<int32_t> letters;
+        for (const string& word : words)
+        {
+            for (size_t i = 0; i < word.size();)
+            {
+                const int32_t code_point = DecodeUtf8(word, i);
+                if (code_point < 0)
+                {
+                    throw runtime_error("malformed UTF-8 in word");
+                }
+                if (Mark(code_point))
+                {
+                    letters.push_back(code_point);
+                }
+            }
+        }
+        Assign(letters);
+    }
+
+    static Alphabet Latin()
+    {
+        vector<int32_t> letters;
+        for (int c = 'a'; c <= 'z'; ++c)
+        {
+            letters.push_back(c);
+        }
+        return FromLetters(letters);
+    }
+
+    static Alphabet FromLetters(vector<int32_t> letters)
+    {
+        Alphabet alphabet;
+        alphabet.Assign(move(letters));
+        return alphabet;
+    }
+
+    int size() const
+    {
+        return (int)m_letters.size();
+    }
+
+    int32_t Letter(int symbol) const
+    {
+        return m_letters[symbol];
+    }
+
+    // -1 if the code point is not in the alphabet.
+    int SymbolOf(int32_t code_point) const
+    {
+        if (code_point >= 0 && code_point < (int32_t)m_dense.size())
+        {
+            return m_dense[code_point] - 1;
+        }
+        const auto it = lower_bound(m_sparse.begin(), m_sparse.end(), code_point,
+            [](const pair<int32_t, int>& entry, int32_t key) { return entry.first < key; });
+        return it != m_sparse.end() && it->first == code_point ? it->second : -1;
+    }
+
+    // UTF-8 to symbols. False if the text has a letter outside the alphabet or is malformed.
+    bool Encode(string_view text, string& out) const
+    {
+        out.clear();
+        for (size_t i = 0; i < text.size();)
+        {
+            const int symbol = SymbolOf(DecodeUtf8(text, i));
+            if (symbol < 0)
+            {
+                return false;
+            }
+            out += SymbolChar(symbol);
+        }
+        return true;
+    }
+
+    // Words with letters outside the alphabet are left out.
+    vector<string> EncodeWords(const vector<string>& words) const
+    {
+        vector<string> encoded;
+        encoded.reserve(words.size());
+        string symbols;
+        for (const string& word : words)
+        {
+            if (Encode(word, symbols))
+            {
+                encoded.push_back(symbols);
+            }
+        }
+        return encoded;
+    }
+
+    // One UTF-8 string per row, one letter per cell. Throws on letters outside the alphabet, the
+    // finders can't represent them.
+    vector<vector<char>> EncodeBoard(const vector<string>& rows) const
+    {
+        vector<vector<char>> board;
+        board.reserve(rows.size());
+        string symbols;
+        for (const string& row : rows)
+        {
+            if (!Encode(row, symbols))
+            {
+                throw runtime_error("board letter outside the alphabet");
+            }
+            board.emplace_back(symbols.begin(), symbols.end());
+        }
+        return board;
+    }
+
+    string Decode(string_view symbols) const
+    {
+        string text;
+        text.reserve(symbols.size());
+        for (char c : symbols)
+        {
+            AppendUtf8(m_letters[Symbol(c)], text);
+        }
+        return text;
+    }
+
+private:
+    static constexpr int32_t DenseLimit = 0x800; // direct lookup up to the end of two-byte UTF-8
+
+    vector<int32_t> m_letters;          // symbol -> code point
+    vector<uint8_t> m_dense;            // code point -> symbol + 1, 0 if absent
+    vector<pair<int32_t, int>> m_sparse; // code points past DenseLimit, sorted
+
+    // Records a letter while collecting them, true the first time.
+    bool Mark(int32_t code_point)
+    {
+        if (code_point < DenseLimit)
+        {
+            m_dense.resize(DenseLimit, 0);
+            if (m_dense[code_point])
+            {
+                return false;
+            }
+            m_dense[code_point] = 1;
+            return true;
+        }
+        const auto it = lower_bound(m_sparse.begin(), m_sparse.end(), make_pair(code_point, 0));
+        if (it != m_sparse.end() && it->first == code_point)
+        {
+            return false;
+        }
+        m_sparse.insert(it, { code_point, 0 });
+        return true;
+    }
+
+    void Assign(vector<int32_t> letters)
+    {
+        sort(letters.begin(), letters.end());
+        letters.erase(unique(letters.begin(), letters.end()), letters.end());
+        if ((int)letters.size() > MaxSymbols)
+        {
+            throw runtime_error("alphabet has " + to_string(letters.size()) + " letters, at most " + to_string(MaxSymbols) + " are supported");
+        }
+        m_letters = move(letters);
+        m_dense.assign(DenseLimit, 0);
+        m_sparse.clear();
+        for (int symbol = 0; symbol < size(); ++symbol)
+        {
+            const int32_t code_point = m_letters[symbol];
+            if (code_point < DenseLimit)
+            {
+                m_dense[code_point] = uint8_t(symbol + 1);
+            }
+            else
+            {
+                m_sparse.push_back({ code_point, symbol });
+            }
+        }
+    }
+};
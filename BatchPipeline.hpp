@@ -0,0 +1,446 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Dictionary.hpp"
+
+using namespace std;
+
+// Blocking queue with a fixed capacity, push() waits while it is full. After close() pop() drains
+// what is left and then returns false.
+template <typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(size_t capacity) : m_capacity(capacity)
+    {
+    }
+
+    void push(T&& item)
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_not_full.wait(lock, [&] { return m_items.size() < m_capacity; });
+        m_items.push_back(move(item));
+        m_not_empty.notify_one();
+    }
+
+    bool pop(T& item)
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_not_empty.wait(lock, [&] { return !m_items.empty() || m_closed; });
+        if (m_items.empty())
+        {
+            return false;
+        }
+        item = move(m_items.front());
+        m_items.pop_front();
+        m_not_full.notify_one();
+        return true;
+    }
+
+    // pop() that gives up at deadline, false then as well.
+    template <typename Clock, typename Duration>
+    bool pop_until(T& item, const chrono::time_point<Clock, Duration>& deadline)
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_not_empty.wait_until(lock, deadline, [&] { return !m_items.empty() || m_closed; });
+        if (m_items.empty())
+        {
+            return false;
+        }
+        item = move(m_items.front());
+        m_items.pop_front();
+        m_not_full.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_closed = true;
+        m_not_empty.notify_all();
+    }
+
+private:
+    mutex m_mutex;
+    condition_variable m_not_full;
+    condition_variable m_not_empty;
+    deque<T> m_items;
+    size_t m_capacity;
+    bool m_closed{ false };
+};
+
+struct BatchOptions
+{
+    int threads{ 0 };         // search workers, 0 - one per core
+    size_t max_in_flight{ 256 }; // boards read but not written yet, bounds memory in both output modes
+    bool ordered{ true };     // write results in input order
+};
+
+struct BatchStats
+{
+    uint64_t boards{ 0 };
+    uint64_t rejected{ 0 }; // skipped by the prefilter
+    uint64_t errors{ 0 };
+    uint64_t words{ 0 };
+    double seconds{ 0 };
+};
+
+struct BoardRecord
+{
+    uint64_t seq{ 0 };
+    string id;
+    vector<vector<char>> board;
+    string error;
+};
+
+struct ResultRecord
+{
+    uint64_t seq{ 0 };
+    string text;
+    uint64_t words{ 0 };
+    bool rejected{ false };
+    bool error{ false };
+};
+
+// Input is one board per line, either rows separated by '/' ("oaan/etae/ihkr/iflv") or a JSON
+// object with an optional "id" and a "board" array of row strings:
+//   {"id": "b1", "board": ["oaan", "etae", "ihkr", "iflv"]}
+// Only that shape is understood, this is not a general JSON parser. Rows are UTF-8 and are encoded
+// with the dictionary's alphabet.
+inline bool ParseBoardLine(const string& line, const Alphabet& alphabet, BoardRecord& record)
+{
+    vector<string> rows;
+    size_t pos = line.find_first_not_of(" \t");
+    if (pos == string::npos)
+    {
+        return false;
+    }
+    if (line[pos] == '{')
+    {
+        auto read_string = [&](size_t& p, string& out) -> bool
+        {
+            p = line.find('"', p);
+            if (p == string::npos)
+            {
+                return false;
+            }
+            const size_t end = line.find('"', p + 1);
+            if (end == string::npos)
+            {
+                return false;
+            }
+            out = line.substr(p + 1, end - p - 1);
+            p = end + 1;
+            return true;
+        };
+
+        const size_t id_pos = line.find("\"id\"");
+        if (id_pos != string::npos)
+        {
+            size_t p = line.find(':', id_pos);
+            size_t value = p == string::npos ? p : line.find_first_not_of(" \t", p + 1);
+            if (value != string::npos && line[value] == '"')
+            {
+                read_string(value, record.id);
+            }
+            else if (value != string::npos)
+            {
+                const size_t end = line.find_first_of(",} \t", value);
+                record.id = line.substr(value, end == string::npos ? end : end - value);
+            }
+        }
+        const size_t board_pos = line.find("\"board\"");
+        size_t p = board_pos == string::npos ? board_pos : line.find('[', board_pos);
+        const size_t end = p == string::npos ? p : line.find(']', p);
+        if (end == string::npos)
+        {
+            record.error = "missing board";
+            return true;
+        }
+        string row;
+        while (read_string(p, row) && p <= end)
+        {
+            rows.push_back(row);
+        }
+    }
+    else
+    {
+        size_t start = pos;
+        size_t end = line.find_last_not_of(" \t\r") + 1;
+        while (start < end)
+        {
+            size_t slash = line.find('/', start);
+            if (slash == string::npos || slash > end)
+            {
+                slash = end;
+            }
+            rows.push_back(line.substr(start, slash - start));
+            start = slash + 1;
+        }
+    }
+
+    if (rows.empty() || rows[0].empty())
+    {
+        record.error = "empty board";
+        return true;
+    }
+    string symbols;
+    for (auto& row : rows)
+    {
+        if (!alphabet.Encode(row, symbols))
+        {
+            record.error = "unsupported letter";
+            return true;
+        }
+        if (!record.board.empty() && symbols.size() != record.board[0].size())
+        {
+            record.error = "rows differ in length";
+            return true;
+        }
+        record.board.emplace_back(symbols.begin(), symbols.end());
+    }
+    return true;
+}
+
+inline void AppendJsonString(string& out, const string& value)
+{
+    static const char Hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (uint8_t(c) >= 0x20)
+        {
+            out += c;
+        }
+        else if (c == '\t')
+        {
+            out += "\\t";
+        }
+        else if (c == '\r')
+        {
+            out += "\\r";
+        }
+        else if (c == '\n')
+        {
+            out += "\\n";
+        }
+        else
+        {
+            out += "\\u00";
+            out += Hex[uint8_t(c) >> 4];
+            out += Hex[uint8_t(c) & 15];
+        }
+    }
+    out += '"';
+}
+
+// The shortest prefixes every word of the dictionary starts with: a root edge that is a word, or
+// else the patterns of the root's children. A board that doesn't have the letters of any of them,
+// counted with repeats, holds no word. Shortest first, they are the likeliest to fit.
+inline vector<string_view> FirstEdges(const TrieView& tree)
+{
+    vector<string_view> edges;
+    for (const uint32_t root_idx : tree.Roots)
+    {
+        if (!root_idx)
+        {
+            continue;
+        }
+        const Node& root{ tree.nodes[root_idx] };
+        if (root.mask > 0 || !root.children_num)
+        {
+            edges.push_back(tree.pattern(root));
+            continue;
+        }
+        for (int k = 0; k < root.children_num; ++k)
+        {
+            edges.push_back(tree.pattern(tree.nodes[tree.child_pool[root.children + k]]));
+        }
+    }
+    sort(edges.begin(), edges.end(), [](string_view a, string_view b) { return a.size() < b.size(); });
+    return edges;
+}
+
+inline bool LettersFit(string_view edge, const int* occ)
+{
+    int need[MaxSymbols] = {};
+    for (char c : edge)
+    {
+        if (++need[Symbol(c)] > occ[Symbol(c)])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Streams boards from in to out as NDJSON results:
+//   parse (reader thread) -> prefilter, search, serialize (worker threads) -> write (caller thread)
+// The stages are connected with bounded queues and at most max_in_flight boards are between the
+// reader and the writer at any time.
+inline BatchStats RunBatch(const Dictionary& dictionary, istream& in, ostream& out, BatchOptions options)
+{
+    if (options.threads <= 0)
+    {
+        options.threads = max(1u, thread::hardware_concurrency());
+    }
+    options.max_in_flight = max<size_t>(options.max_in_flight, 1);
+
+    BoundedQueue<BoardRecord> boards{ options.max_in_flight };
+    BoundedQueue<ResultRecord> results{ options.max_in_flight };
+
+    mutex in_flight_mutex;
+    condition_variable in_flight_cv;
+    size_t in_flight{ 0 };
+
+    const vector<string_view> first_edges{ FirstEdges(dictionary.Tree()) };
+
+    const auto start_time = chrono::steady_clock::now();
+
+    thread reader([&]
+    {
+        string line;
+        uint64_t seq{ 0 };
+        while (getline(in, line))
+        {
+            BoardRecord record;
+            if (!ParseBoardLine(line, dictionary.Letters(), record))
+            {
+                continue;
+            }
+            record.seq = seq++;
+            {
+                unique_lock<mutex> lock(in_flight_mutex);
+                in_flight_cv.wait(lock, [&] { return in_flight < options.max_in_flight; });
+                ++in_flight;
+            }
+            boards.push(move(record));
+        }
+        boards.close();
+    });
+
+    auto work = [&]
+    {
+        DictionaryQuery query;
+        vector<string> words;
+        BoardRecord record;
+        while (boards.pop(record))
+        {
+            WORDSEARCH_PROFILE_SCOPE("batch_board");
+            ResultRecord result;
+            result.seq = record.seq;
+            result.text = "{\"id\":";
+            AppendJsonString(result.text, record.id.empty() ? to_string(record.seq) : record.id);
+            if (!record.error.empty())
+            {
+                result.error = true;
+                result.text += ",\"error\":";
+                AppendJsonString(result.text, record.error);
+                result.text += "}\n";
+                results.push(move(result));
+                continue;
+            }
+
+            // Letter-histogram prefilter: the board needs the letters of one of the first edges.
+            int occ[MaxSymbols] = {};
+            for (auto& row : record.board)
+            {
+                for (char c : row)
+                {
+                    ++occ[Symbol(c)];
+                }
+            }
+            words.clear();
+            if (any_of(first_edges.begin(), first_edges.end(), [&](string_view edge) { return LettersFit(edge, occ); }))
+            {
+                query.FindWords(dictionary, record.board, words);
+            }
+            else
+            {
+                result.rejected = true;
+            }
+
+            result.words = words.size();
+            result.text += ",\"words\":[";
+            for (size_t i = 0; i < words.size(); ++i)
+            {
+                if (i)
+                {
+                    result.text += ',';
+                }
+                AppendJsonString(result.text, dictionary.Letters().Decode(words[i]));
+            }
+            result.text += "]}\n";
+            results.push(move(result));
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 0; t < options.threads; ++t)
+    {
+        workers.emplace_back(work);
+    }
+    thread closer([&]
+    {
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        results.close();
+    });
+
+    BatchStats stats;
+    map<uint64_t, ResultRecord> pending; // ordered mode only, holds results that came early
+    uint64_t next_seq{ 0 };
+    auto write = [&](const ResultRecord& result)
+    {
+        out << result.text;
+        ++stats.boards;
+        stats.words += result.words;
+        stats.rejected += result.rejected;
+        stats.errors += result.error;
+        {
+            lock_guard<mutex> lock(in_flight_mutex);
+            --in_flight;
+        }
+        in_flight_cv.notify_one();
+    };
+
+    ResultRecord result;
+    while (results.pop(result))
+    {
+        if (!options.ordered)
+        {
+            write(result);
+            continue;
+        }
+        pending.emplace(result.seq, move(result));
+        for (auto it = pending.begin(); it != pending.end() && it->first == next_seq; it = pending.erase(it))
+        {
+            write(it->second);
+            ++next_seq;
+        }
+    }
+    out.flush();
+
+    reader.join();
+    closer.join();
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    return stats;
+}
@@ -0,0 +1,671 @@
+// Benchmark suite for SuffixTree::Build, FindWordsAuto, FindWordsTiled, DictionaryQuery and
+// TopKQuery, the finder and grid variants and the topologies, separate from the demo:
+//
+//   g++ -std=c++17 -O2 -pthread Benchmark.cpp -o wordsearch_bench    (or CMakeLists.txt)
+//   wordsearch_bench [--quick | --full] [--runs N] [--seed N] [--filter text] [--list]
+//                    [--compare baseline.jsonl [--tolerance 0.1]]
+//
+// Every scenario runs in its own forked process, so peak RSS is per scenario, and prints one JSON
+// line to stdout. With --compare the p50 build, search, query and top-10 times are checked against an
+// earlier run's output and the exit code is 1 if any is slower than the tolerance allows.
+// Linux only (fork, getrusage).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "SuffixTree.hpp"
+#include "WordFinder.hpp"
+#include "BoardWordFinder.hpp"
+#include "Dictionary.hpp"
+#include "IncrementalSearch.hpp"
+#include "TiledWordFinder.hpp"
+#include "TopKQuery.hpp"
+#include "Workloads.hpp"
+
+using namespace std;
+
+// Instrumented builds (WORDSEARCH_PGO=GENERATE in CMakeLists.txt) write their profile at exit,
+// which _exit skips, so the scenario processes write theirs before. Weak, so every build has the
+// same code and the profile matches the optimized build.
+extern "C" void __gcov_dump(void) __attribute__((weak));
+extern "C" int __llvm_profile_write_file(void) __attribute__((weak));
+
+void WriteTrainingProfile()
+{
+    if (__gcov_dump)
+    {
+        __gcov_dump();
+    }
+    if (__llvm_profile_write_file)
+    {
+        __llvm_profile_write_file();
+    }
+}
+
+enum class ScenarioKind
+{
+    Search,     // RunScenario: builds, searches, queries, top-K and updates
+    Layouts,    // RunLayouts: the DFSWordFinder sizes, the board-driven finder and the query grids
+    Topologies, // RunTopologies: DFSWordFinder and DictionaryQuery under every adjacency
+};
+
+struct Scenario
+{
+    string name;
+    int m;
+    int n;
+    function<vector<string>(unsigned seed)> words;
+    function<vector<vector<char>>(unsigned seed)> board; // called with a different seed every run
+    int updates{ 0 }; // single cell changes timed with IncrementalSearch
+    ScenarioKind kind{ ScenarioKind::Search };
+};
+
+struct Percentiles
+{
+    double mean{ 0 };
+    double p50{ 0 };
+    double p90{ 0 };
+    double p99{ 0 };
+    double max{ 0 };
+
+    Percentiles(vector<double> samples)
+    {
+        if (samples.empty())
+        {
+            return;
+        }
+        sort(samples.begin(), samples.end());
+        for (double sample : samples)
+        {
+            mean += sample;
+        }
+        mean /= samples.size();
+        auto at = [&](double q) { return samples[min(samples.size() - 1, size_t(q * samples.size()))]; };
+        p50 = at(0.5);
+        p90 = at(0.9);
+        p99 = at(0.99);
+        max = samples.back();
+    }
+};
+
+void WriteJson(ostream& out, const char* key, const Percentiles& value)
+{
+    out << ",\"" << key << "\":{\"mean\":" << value.mean << ",\"p50\":" << value.p50 << ",\"p90\":" << value.p90
+        << ",\"p99\":" << value.p99 << ",\"max\":" << value.max << "}";
+}
+
+double ElapsedUs(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+void WriteHeader(ostream& out, const Scenario& scenario, size_t dictionary, int runs, unsigned seed)
+{
+    out << "{\"scenario\":\"" << scenario.name << "\",\"board\":\"" << scenario.m << "x" << scenario.n
+        << "\",\"dictionary\":" << dictionary << ",\"runs\":" << runs << ",\"seed\":" << seed;
+}
+
+void WriteFooter(ostream& out)
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    out << ",\"peak_rss_kb\":" << usage.ru_maxrss << "}";
+}
+
+// Runs the scenario and returns its result line.
+string RunScenario(const Scenario& scenario, int runs, unsigned seed)
+{
+    const vector<string> words{ scenario.words(seed) };
+
+    auto start = chrono::steady_clock::now();
+    const Dictionary dictionary{ words };
+    const double dictionary_build_ms = ElapsedUs(start) / 1000;
+
+    // The same tree with the one-word-at-a-time Build, for comparison.
+    start = chrono::steady_clock::now();
+    {
+        SuffixTree serial;
+        serial.Build(words);
+    }
+    const double serial_build_ms = ElapsedUs(start) / 1000;
+
+    start = chrono::steady_clock::now();
+    const ScoreBounds longest{ dictionary.Tree(), LetterScores::Length() };
+    const double bounds_ms = ElapsedUs(start) / 1000;
+
+    vector<double> build_ms, search_us, query_us, word_us, top10_us;
+    vector<double> runs_search_us, cost_build_ms, cost_search_us, tiled_search_us;
+    size_t words_found{ 0 };
+    size_t tree_nodes{ 0 };
+    size_t inserted_words{ 0 };
+    int board_driven{ 0 };
+    DictionaryQuery query;
+    TopKQuery top_query;
+    for (int run = 0; run < runs; ++run)
+    {
+        const vector<vector<char>> board{ scenario.board(seed + run) };
+
+        // The search consumes the tree, so every run builds a new one.
+        SuffixTree tree;
+        start = chrono::steady_clock::now();
+        tree.Build(words, board);
+        build_ms.push_back(ElapsedUs(start) / 1000);
+        tree_nodes = tree.nodes.size();
+        inserted_words = tree.word_count;
+
+        board_driven += PreferBoardDriven(tree, board);
+
+        vector<string> found;
+        start = chrono::steady_clock::now();
+        FindWordsAuto(tree, board, found);
+        search_us.push_back(ElapsedUs(start));
+        word_us.push_back(search_us.back() / max<size_t>(found.size(), 1));
+        words_found += found.size();
+
+        // The same search with each word orientation forced, see Orientation.hpp.
+        for (const OrientationPolicy policy : { OrientationPolicy::Runs, OrientationPolicy::BoardCost })
+        {
+            SuffixTree forced;
+            forced.orientation = policy;
+            start = chrono::steady_clock::now();
+            forced.Build(words, board);
+            const double forced_build_ms = ElapsedUs(start) / 1000;
+            found.clear();
+            start = chrono::steady_clock::now();
+            FindWordsAuto(forced, board, found);
+            if (policy == OrientationPolicy::Runs)
+            {
+                runs_search_us.push_back(ElapsedUs(start));
+            }
+            else
+            {
+                cost_build_ms.push_back(forced_build_ms);
+                cost_search_us.push_back(ElapsedUs(start));
+            }
+        }
+
+        // The tiled search on one thread, it doesn't consume the tree.
+        {
+            SuffixTree tiled;
+            tiled.Build(words, board);
+            found.clear();
+            start = chrono::steady_clock::now();
+            FindWordsTiled(tiled, board, found, 1);
+            tiled_search_us.push_back(ElapsedUs(start));
+        }
+
+        found.clear();
+        start = chrono::steady_clock::now();
+        query.FindWords(dictionary, board, found);
+        query_us.push_back(ElapsedUs(start));
+
+        found.clear();
+        start = chrono::steady_clock::now();
+        top_query.FindTopWords(dictionary, longest, board, 10, found);
+        top10_us.push_back(ElapsedUs(start));
+    }
+
+    vector<double> update_us;
+    if (scenario.updates)
+    {
+        mt19937 rng{ seed };
+        IncrementalSearch incremental{ dictionary, scenario.board(seed) };
+        for (int update = 0; update < scenario.updates; ++update)
+        {
+            const vector<CellChange> changes{ { int(rng() % scenario.m), int(rng() % scenario.n), char('a' + rng() % 26) } };
+            start = chrono::steady_clock::now();
+            incremental.Update(changes);
+            update_us.push_back(ElapsedUs(start));
+        }
+    }
+
+    ostringstream out;
+    WriteHeader(out, scenario, words.size(), runs, seed);
+    out << ",\"words_found\":" << words_found / max(runs, 1) << ",\"tree_nodes\":" << tree_nodes << ",\"inserted_words\":" << inserted_words
+        << ",\"board_driven_runs\":" << board_driven
+        << ",\"dictionary_build_ms\":" << dictionary_build_ms << ",\"serial_build_ms\":" << serial_build_ms << ",\"score_bounds_ms\":" << bounds_ms;
+    WriteJson(out, "build_ms", Percentiles(build_ms));
+    WriteJson(out, "search_us", Percentiles(search_us));
+    WriteJson(out, "runs_orientation_search_us", Percentiles(runs_search_us));
+    WriteJson(out, "cost_orientation_build_ms", Percentiles(cost_build_ms));
+    WriteJson(out, "cost_orientation_search_us", Percentiles(cost_search_us));
+    WriteJson(out, "tiled_search_us", Percentiles(tiled_search_us));
+    WriteJson(out, "query_us", Percentiles(query_us));
+    WriteJson(out, "search_us_per_word", Percentiles(word_us));
+    WriteJson(out, "top10_us", Percentiles(top10_us));
+    if (scenario.updates)
+    {
+        WriteJson(out, "update_us", Percentiles(update_us));
+    }
+    WriteFooter(out);
+    return out.str();
+}
+
+// Times a finder that consumes its tree, with a new tree every run. Nothing is written if the
+// finder can't hold the board or the longest word.
+template <typename Finder>
+void TimeFinder(ostream& out, const char* key, const vector<string>& words, const vector<vector<char>>& board, int runs)
+{
+    vector<double> samples;
+    for (int run = 0; run < runs; ++run)
+    {
+        SuffixTree tree;
+        tree.Build(words, board);
+        if (!Finder::Fits(board, tree))
+        {
+            return;
+        }
+        vector<string> found;
+        const auto start = chrono::steady_clock::now();
+        Finder finder{ board, found };
+        finder.FindWords(tree);
+        samples.push_back(ElapsedUs(start));
+    }
+    WriteJson(out, key, Percentiles(samples));
+}
+
+template <typename Grid>
+void TimeGrid(ostream& out, const char* key, const Dictionary& dictionary, const vector<vector<char>>& board, int runs, size_t* words_found = nullptr)
+{
+    BasicDictionaryQuery<Grid> query;
+    vector<double> samples;
+    vector<string> found;
+    for (int run = 0; run < runs; ++run)
+    {
+        found.clear();
+        const auto start = chrono::steady_clock::now();
+        query.FindWords(dictionary, board, found);
+        samples.push_back(ElapsedUs(start));
+    }
+    if (words_found)
+    {
+        *words_found = found.size();
+    }
+    WriteJson(out, key, Percentiles(samples));
+}
+
+// One board, searched runs times by every engine variant that can hold it.
+string RunLayouts(const Scenario& scenario, int runs, unsigned seed)
+{
+    const vector<string> words{ scenario.words(seed) };
+    const vector<vector<char>> board{ scenario.board(seed) };
+    const Dictionary dictionary{ words };
+
+    ostringstream fields;
+    size_t words_found{ 0 };
+    TimeGrid<CellGrid>(fields, "query_cell_grid_us", dictionary, board, runs, &words_found);
+    if (RowBitboardGrid::Fits(board))
+    {
+        TimeGrid<RowBitboardGrid>(fields, "query_row_bitboard_us", dictionary, board, runs);
+    }
+    if (BitboardGrid::Fits(board))
+    {
+        TimeGrid<BitboardGrid>(fields, "query_bitboard_us", dictionary, board, runs);
+    }
+    TimeFinder<SmallDFSWordFinder>(fields, "dfs_small_us", words, board, runs);
+    TimeFinder<MediumDFSWordFinder>(fields, "dfs_medium_us", words, board, runs);
+    TimeFinder<DynamicDFSWordFinder>(fields, "dfs_dynamic_us", words, board, runs);
+    TimeFinder<BoardWordFinder>(fields, "board_driven_us", words, board, runs);
+
+    ostringstream out;
+    WriteHeader(out, scenario, words.size(), runs, seed);
+    out << ",\"words_found\":" << words_found << fields.str();
+    WriteFooter(out);
+    return out.str();
+}
+
+template <typename Topology>
+void TimeTopology(ostream& out, const string& name, const vector<string>& words, const Dictionary& dictionary,
+    const vector<vector<char>>& board, int runs)
+{
+    vector<double> dfs_us, query_us;
+    size_t words_found{ 0 };
+    BasicDictionaryQuery<BasicCellGrid<Topology>> query;
+    for (int run = 0; run < runs; ++run)
+    {
+        SuffixTree tree;
+        tree.Build<Topology>(words, board);
+        vector<string> found;
+        auto start = chrono::steady_clock::now();
+        FindWordsDFS<Topology>(tree, board, found);
+        dfs_us.push_back(ElapsedUs(start));
+        words_found = found.size();
+
+        found.clear();
+        start = chrono::steady_clock::now();
+        query.FindWords(dictionary, board, found);
+        query_us.push_back(ElapsedUs(start));
+    }
+    out << ",\"" << name << "_words\":" << words_found;
+    WriteJson(out, (name + "_dfs_us").c_str(), Percentiles(dfs_us));
+    WriteJson(out, (name + "_query_us").c_str(), Percentiles(query_us));
+}
+
+// One board and dictionary under every adjacency: more neighbours mean a wider search.
+string RunTopologies(const Scenario& scenario, int runs, unsigned seed)
+{
+    const vector<string> words{ scenario.words(seed) };
+    const vector<vector<char>> board{ scenario.board(seed) };
+    const Dictionary dictionary{ words };
+
+    ostringstream out;
+    WriteHeader(out, scenario, words.size(), runs, seed);
+    TimeTopology<Orthogonal>(out, "orthogonal", words, dictionary, board, runs);
+    TimeTopology<Toroidal>(out, "toroidal", words, dictionary, board, runs);
+    TimeTopology<Hexagonal>(out, "hexagonal", words, dictionary, board, runs);
+    TimeTopology<Diagonal>(out, "diagonal", words, dictionary, board, runs);
+    WriteFooter(out);
+    return out.str();
+}
+
+vector<Scenario> Scenarios(bool quick, bool full)
+{
+    vector<Scenario> scenarios;
+    const LetterDistribution uniform{ LetterDistribution::Uniform() };
+    const LetterDistribution english{ LetterDistribution::English() };
+
+    // Board shape and letter distribution, 100k words with the same distribution.
+    for (auto& [dist_name, dist] : { pair<const char*, LetterDistribution>{ "uniform", uniform }, { "english", english } })
+    {
+        for (int side : { 4, 10, 50 })
+        {
+            if (quick && side == 50)
+            {
+                continue;
+            }
+            scenarios.push_back({ string("random_") + dist_name + "_" + to_string(side) + "x" + to_string(side), side, side,
+                [dist = dist](unsigned seed) { return RandomWords(100000, 3, 10, seed, dist); },
+                [side, dist = dist](unsigned seed) { return RandomBoard(side, side, seed, dist); } });
+        }
+    }
+
+    // Dictionary size on a 10x10 English board.
+    vector<int> sizes{ 1000, 10000, 100000 };
+    if (!quick)
+    {
+        sizes.push_back(1000000);
+    }
+    if (full)
+    {
+        sizes.push_back(5000000);
+    }
+    for (int size : sizes)
+    {
+        scenarios.push_back({ "dictionary_" + to_string(size), 10, 10,
+            [size, english](unsigned seed) { return RandomWords(size, 3, 12, seed, english); },
+            [english](unsigned seed) { return RandomBoard(10, 10, seed, english); } });
+    }
+
+    // Few long stems, most words share an 8-16 letter prefix.
+    for (int size : { 100000, 1000000 })
+    {
+        if (quick && size > 100000)
+        {
+            continue;
+        }
+        scenarios.push_back({ "shared_prefix_" + to_string(size), 10, 10,
+            [size, english](unsigned seed) { return SharedPrefixWords(size, 1000, 16, 4, seed, english); },
+            [english](unsigned seed) { return RandomBoard(10, 10, seed, english); } });
+    }
+
+    // Larger alphabets: Greek has 24 letters, Polish 32, Cyrillic plus digit tiles 43.
+    for (int letters : { 32, 43 })
+    {
+        const LetterDistribution symbols{ LetterDistribution::FirstLetters(letters) };
+        scenarios.push_back({ "alphabet_" + to_string(letters) + "_50x50", 50, 50,
+            [symbols](unsigned seed) { return RandomWords(100000, 3, 10, seed, symbols); },
+            [symbols](unsigned seed) { return RandomBoard(50, 50, seed, symbols); } });
+    }
+
+    // Huge boards, where the grid no longer fits in cache.
+    for (int side : { 300, 1000 })
+    {
+        if ((quick && side == 300) || (!full && side == 1000))
+        {
+            continue;
+        }
+        scenarios.push_back({ "huge_english_" + to_string(side) + "x" + to_string(side), side, side,
+            [english](unsigned seed) { return RandomWords(100000, 3, 10, seed, english); },
+            [side, english](unsigned seed) { return RandomBoard(side, side, seed, english); } });
+    }
+
+    // A few tiles change at a time.
+    scenarios.push_back({ "incremental_100x100", 100, 100,
+        [english](unsigned seed) { return RandomWords(100000, 3, 10, seed, english); },
+        [english](unsigned seed) { return RandomBoard(100, 100, seed, english); }, quick ? 200 : 2000 });
+
+    // Adversarial boards: every path matches the prefix.
+    const int side = quick ? 8 : 12;
+    scenarios.push_back({ "single_letter_" + to_string(side) + "x" + to_string(side), side, side,
+        [side](unsigned) { return PrefixedPairWords(string(side - 4, 'a')); },
+        [side](unsigned) { return FramedSingleLetterBoard(side); } });
+    scenarios.push_back({ "two_letter_10x10", 10, 10,
+        [](unsigned) { return PrefixedPairWords("abababab"); },
+        [](unsigned) { return TwoLetterBoard(10, 10); } });
+
+    // Engine variants on the demo's dictionary and on boards with words past the old 10 letter
+    // path limit: 250x250 fits the 16-bit DFSWordFinder, 300x300 only the dynamic one.
+    for (int side : { 10, 8 })
+    {
+        scenarios.push_back({ "layouts_two_letter_" + to_string(side) + "x" + to_string(side), side, side,
+            [](unsigned) { return PrefixedPairWords("abababab"); },
+            [side](unsigned) { return TwoLetterBoard(side, side); }, 0, ScenarioKind::Layouts });
+    }
+    for (int side : { 250, 300 })
+    {
+        if (quick)
+        {
+            continue;
+        }
+        scenarios.push_back({ "layouts_walk_" + to_string(side) + "x" + to_string(side), side, side,
+            [side](unsigned seed) { return RandomWalkWords(RandomBoard(side, side, seed), 2000, 12, 48, seed + 1); },
+            [side](unsigned seed) { return RandomBoard(side, side, seed); }, 0, ScenarioKind::Layouts });
+    }
+
+    // 200k random words and 2000 walks over the board, under every adjacency.
+    for (int side : { 5, 50 })
+    {
+        if (quick && side == 50)
+        {
+            continue;
+        }
+        scenarios.push_back({ "topologies_" + to_string(side) + "x" + to_string(side), side, side,
+            [side](unsigned seed)
+            {
+                vector<string> words{ RandomWords(200000, 3, 8, seed) };
+                const vector<string> walks{ RandomWalkWords(RandomBoard(side, side, seed), 2000, 3, 12, seed + 1) };
+                words.insert(words.end(), walks.begin(), walks.end());
+                return words;
+            },
+            [side](unsigned seed) { return RandomBoard(side, side, seed); }, 0, ScenarioKind::Topologies });
+    }
+    return scenarios;
+}
+
+// Value of "key":{..."field":value...} or "key":value in one of our result lines.
+double JsonNumber(const string& line, const string& key, const string& field = "")
+{
+    size_t pos = line.find("\"" + key + "\":");
+    if (pos == string::npos)
+    {
+        return -1;
+    }
+    if (!field.empty())
+    {
+        pos = line.find("\"" + field + "\":", pos);
+        if (pos == string::npos)
+        {
+            return -1;
+        }
+        pos += field.size() + 3;
+    }
+    else
+    {
+        pos += key.size() + 3;
+    }
+    return atof(line.c_str() + pos);
+}
+
+string JsonString(const string& line, const string& key)
+{
+    const size_t pos = line.find("\"" + key + "\":\"");
+    if (pos == string::npos)
+    {
+        return "";
+    }
+    const size_t start = pos + key.size() + 4;
+    return line.substr(start, line.find('"', start) - start);
+}
+
+int main(int argc, char** argv)
+{
+    bool quick{ false };
+    bool full{ false };
+    bool list{ false };
+    int runs{ 10 };
+    unsigned seed{ 1 };
+    string filter;
+    string baseline_path;
+    double tolerance{ 0.1 };
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg{ argv[i] };
+        const bool has_value{ i + 1 < argc };
+        if (arg == "--quick")
+        {
+            quick = true;
+        }
+        else if (arg == "--full")
+        {
+            full = true;
+        }
+        else if (arg == "--list")
+        {
+            list = true;
+        }
+        else if (arg == "--runs" && has_value)
+        {
+            runs = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--seed" && has_value)
+        {
+            seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--filter" && has_value)
+        {
+            filter = argv[++i];
+        }
+        else if (arg == "--compare" && has_value)
+        {
+            baseline_path = argv[++i];
+        }
+        else if (arg == "--tolerance" && has_value)
+        {
+            tolerance = atof(argv[++i]);
+        }
+        else
+        {
+            cerr << "unknown argument " << arg << endl;
+            return 2;
+        }
+    }
+
+    map<string, string> baseline;
+    if (!baseline_path.empty())
+    {
+        ifstream file(baseline_path);
+        if (!file)
+        {
+            cerr << "can't open " << baseline_path << endl;
+            return 2;
+        }
+        string line;
+        while (getline(file, line))
+        {
+            baseline[JsonString(line, "scenario")] = line;
+        }
+    }
+
+    bool regressed{ false };
+    for (const Scenario& scenario : Scenarios(quick, full))
+    {
+        if (!filter.empty() && scenario.name.find(filter) == string::npos)
+        {
+            continue;
+        }
+        if (list)
+        {
+            cout << scenario.name << endl;
+            continue;
+        }
+
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0)
+        {
+            perror("pipe");
+            return 2;
+        }
+        cout.flush();
+        const pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(pipe_fds[0]);
+            const string result{ (scenario.kind == ScenarioKind::Layouts ? RunLayouts(scenario, runs, seed)
+                : scenario.kind == ScenarioKind::Topologies ? RunTopologies(scenario, runs, seed)
+                : RunScenario(scenario, runs, seed)) + "\n" };
+            if (write(pipe_fds[1], result.data(), result.size()) != (ssize_t)result.size())
+            {
+                _exit(1);
+            }
+            WriteTrainingProfile();
+            _exit(0);
+        }
+        close(pipe_fds[1]);
+        string result;
+        char buffer[4096];
+        ssize_t size;
+        while ((size = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+        {
+            result.append(buffer, size);
+        }
+        close(pipe_fds[0]);
+        int status{ 0 };
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || result.empty())
+        {
+            cerr << scenario.name << " failed" << endl;
+            regressed = true;
+            continue;
+        }
+        cout << result << flush;
+
+        auto it = baseline.find(scenario.name);
+        if (it == baseline.end())
+        {
+            continue;
+        }
+        for (const char* key : { "build_ms", "search_us", "query_us", "top10_us" })
+        {
+            const double before = JsonNumber(it->second, key, "p50");
+            const double now = JsonNumber(result, key, "p50");
+            if (before > 0 && now > before * (1 + tolerance))
+            {
+                cerr << scenario.name << ": " << key << " p50 " << before << " -> " << now << endl;
+                regressed = true;
+            }
+        }
+    }
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include "Alphabet.hpp"
+#include "Topology.hpp"
+
+using namespace std;
+
+// Which letters follow each other on a board: the letter pairs of adjacent cells and the letter
+// triples of paths over three distinct cells, as bitsets over symbols. A word with a pair or a
+// triple that the board doesn't have can't be on it, whatever the letter counts say; on a sparse
+// board that rules out most of a dictionary before anything is inserted or searched.
+class BoardAdjacency
+{
+public:
+    BoardAdjacency() :
+        m_triples(MaxSymbols * MaxSymbols, 0)
+    {
+        memset(m_pairs, 0, sizeof(m_pairs));
+    }
+
+    template <typename Topology = Orthogonal>
+    void Set(const vector<vector<char>>& board)
+    {
+        memset(m_pairs, 0, sizeof(m_pairs));
+        fill(m_triples.begin(), m_triples.end(), 0);
+        const int m = (int)board.size();
+        const int n = (int)board[0].size();
+        auto letter = [&](int cell) { return Symbol(board[cell / n][cell % n]); };
+        for (int i = 0; i < m; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                const int middle = Symbol(board[i][j]);
+                int cells[Topology::Degree];
+                NeighborCells<Topology>(i, j, m, n, cells);
+                for (int k = 0; k < Topology::Degree; ++k)
+                {
+                    if (cells[k] < 0)
+                    {
+                        continue;
+                    }
+                    const int first = letter(cells[k]);
+                    m_pairs[first] |= uint64_t(1) << middle;
+                    for (int l = 0; l < Topology::Degree; ++l)
+                    {
+                        if (l != k && cells[l] >= 0)
+                        {
+                            m_triples[first * MaxSymbols + middle] |= uint64_t(1) << letter(cells[l]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    bool Pair(int a, int b) const
+    {
+        return (m_pairs[a] >> b) & 1;
+    }
+
+    bool Triple(int a, int b, int c) const
+    {
+        return (m_triples[a * MaxSymbols + b] >> c) & 1;
+    }
+
+    // True if every pair and triple of the text that ends at position from or later is on the
+    // board. With from > 0 only the part of a trie edge past its parent is checked.
+    bool Fits(string_view text, size_t from = 0) const
+    {
+        for (size_t i = from > 0 ? from : 1; i < text.size(); ++i)
+        {
+            const int b = Symbol(text[i - 1]);
+            const int c = Symbol(text[i]);
+            if (!Pair(b, c) || (i >= 2 && !Triple(Symbol(text[i - 2]), b, c)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    uint64_t m_pairs[MaxSymbols];  // [a]: bit b if a cell of a has a neighbour of b
+    vector<uint64_t> m_triples;    // [a * MaxSymbols + b]: bit c if a path a, b, c exists
+};
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SuffixTree.hpp"
+#include "WordFinder.hpp"
+#include "Grids.hpp"
+#include "TiledWordFinder.hpp"
+#include "ResultSink.hpp"
+#include "Profiler.hpp"
+
+using namespace std;
+
+// Board-driven search: the walk is led by the board instead of by the trie edges. At a node
+// boundary every neighbour is probed once and its letter picks the child through children_mask,
+// where DFSWordFinder probes the neighbours again for every child. A (cell, node) boundary state
+// whose search was never cut short by a visited cell is dead: entering it again, with any path,
+// can only explore a subset of what it already explored, so it is marked in a per-query bitset and
+// never re-entered. A node gets its row of cell bits the first time one of its states dies. The
+// tree is only read; found words are tracked per node.
+template <typename Topology = Orthogonal, typename Sink = StringSink>
+class BasicBoardWordFinder
+{
+public:
+    static constexpr uint64_t MaxMemoBits = 1ull << 26; // 8 MB, later nodes are not memoized
+
+    // Any board and tree, same interface as BasicDFSWordFinder.
+    static bool Fits(const vector<vector<char>>&, const SuffixTree&)
+    {
+        return true;
+    }
+
+    BasicBoardWordFinder(const vector<vector<char>>& board, Sink sink) :
+        m_sink(sink)
+    {
+        CheckBoard(board);
+        m_grid.Set(board);
+    }
+
+    void FindWords(const SuffixTree& tree)
+    {
+        WORDSEARCH_PROFILE_SCOPE("board_search");
+        m_tree = &tree;
+        const int cells = m_grid.size();
+        const size_t nodes_num = tree.nodes.size();
+
+        // Children always have larger indices than their parent, so one backward pass counts the
+        // unreported words of every subtree.
+        m_remaining.assign(nodes_num, 0);
+        m_found.assign(nodes_num, 0);
+        for (size_t i = nodes_num; i-- > 1;)
+        {
+            const Node& node{ tree.nodes[i] };
+            m_remaining[i] += node.mask > 0;
+            for (int k = 0; k < node.children_num; ++k)
+            {
+                m_remaining[i] += m_remaining[tree.child_pool[node.children + k]];
+            }
+        }
+        m_row_words = (cells + 63) / 64;
+        m_rows.assign(nodes_num, 0);
+        m_dead.assign(m_row_words, 0); // row 0 is "no row"
+
+        for (int i = 0; i < cells; ++i)
+        {
+            const uint32_t root = tree.Roots[Symbol(m_grid.letter(i))];
+            if (!root || !m_remaining[root])
+            {
+                continue;
+            }
+            m_grid.Visit(i);
+            m_path.push_back(i);
+            Extend(i, root, 1);
+            m_path.pop_back();
+            m_grid.Unvisit(i);
+        }
+    }
+
+private:
+    const SuffixTree* m_tree{ nullptr };
+    Sink m_sink;
+    BasicCellGrid<Topology> m_grid;
+    vector<uint32_t> m_remaining; // words below the node that have not been reported yet
+    vector<uint8_t> m_found;
+    vector<uint32_t> m_ancestors; // boundary nodes of the current path
+    vector<int> m_path;
+    vector<uint32_t> m_rows;      // node -> its row of dead cells in m_dead, allocated on first use
+    vector<uint64_t> m_dead;
+    int m_row_words{ 0 };
+
+    // cell matched pattern[idx - 1] of the node. Returns true if a visited cell was in the way.
+    bool Extend(int cell, uint32_t node_idx, int idx)
+    {
+        const Node& node{ m_tree->nodes[node_idx] };
+        const string_view node_pattern{ m_tree->pattern(node) };
+        if (idx == (int)node_pattern.size())
+        {
+            return Boundary(cell, node_idx, idx);
+        }
+
+        WORDSEARCH_COUNT(NeighborProbes);
+        const char p = node_pattern[idx];
+        const array<int, Topology::Degree>& neighbors{ m_grid.neighbors[cell] };
+        bool blocked{ false };
+        ForEachSlot<Topology::Degree>(0, [&](int slot)
+        {
+            const int neighbor = neighbors[slot];
+            if (neighbor < 0 || m_grid.letters[neighbor] != p)
+            {
+                return true;
+            }
+            if (m_grid.marks[neighbor] == '$')
+            {
+                blocked = true;
+                return true;
+            }
+            m_grid.Visit(neighbor);
+            m_path.push_back(neighbor);
+            blocked |= Extend(neighbor, node_idx, idx + 1);
+            m_path.pop_back();
+            m_grid.Unvisit(neighbor);
+            WORDSEARCH_COUNT(Backtracks);
+            return m_remaining[node_idx] != 0;
+        });
+        return blocked;
+    }
+
+    bool Boundary(int cell, uint32_t node_idx, int depth)
+    {
+        const uint32_t row = m_rows[node_idx];
+        if (row && (m_dead[row + (cell >> 6)] >> (cell & 63) & 1))
+        {
+            return false;
+        }
+        WORDSEARCH_COUNT(NodesVisited);
+        const Node& node{ m_tree->nodes[node_idx] };
+        m_ancestors.push_back(node_idx);
+        if (node.mask > 0 && !m_found[node_idx])
+        {
+            m_found[node_idx] = 1;
+            ReportWords(m_sink, node_idx, node.mask, m_tree->pattern(node), m_path.data(), (int)m_path.size());
+            for (uint32_t ancestor : m_ancestors)
+            {
+                --m_remaining[ancestor];
+            }
+        }
+
+        bool blocked{ false };
+        const array<int, Topology::Degree>& neighbors{ m_grid.neighbors[cell] };
+        ForEachSlot<Topology::Degree>(0, [&](int slot)
+        {
+            const int neighbor = neighbors[slot];
+            if (!m_remaining[node_idx])
+            {
+                return false;
+            }
+            if (neighbor < 0)
+            {
+                return true;
+            }
+            const uint32_t child = m_tree->child(node, Symbol(m_grid.letters[neighbor]));
+            if (!child || !m_remaining[child])
+            {
+                return true;
+            }
+            if (m_grid.marks[neighbor] == '$')
+            {
+                blocked = true;
+                return true;
+            }
+            m_grid.Visit(neighbor);
+            m_path.push_back(neighbor);
+            blocked |= Extend(neighbor, child, depth + 1);
+            m_path.pop_back();
+            m_grid.Unvisit(neighbor);
+            WORDSEARCH_COUNT(Backtracks);
+            return true;
+        });
+        m_ancestors.pop_back();
+        if (!blocked)
+        {
+            MarkDead(cell, node_idx);
+        }
+        return blocked;
+    }
+
+    void MarkDead(int cell, uint32_t node_idx)
+    {
+        uint32_t& row{ m_rows[node_idx] };
+        if (!row)
+        {
+            if ((m_dead.size() + m_row_words) * 64 > MaxMemoBits)
+            {
+                return;
+            }
+            row = (uint32_t)m_dead.size();
+            m_dead.resize(m_dead.size() + m_row_words);
+        }
+        m_dead[row + (cell >> 6)] |= 1ull << (cell & 63);
+    }
+};
+
+using BoardWordFinder = BasicBoardWordFinder<Orthogonal>;
+
+// Expected number of neighbours that continue a path, from the board's letter frequencies:
+// Degree * sum of p(letter)^2. At 1 and above the number of paths grows with their length and the
+// same (cell, node) states are reached over and over.
+template <typename Topology = Orthogonal>
+double PathFanout(const vector<vector<char>>& board)
+{
+    int counts[MaxSymbols] = {};
+    for (auto& row : board)
+    {
+        for (char c : row)
+        {
+            ++counts[Symbol(c)];
+        }
+    }
+    const double cells = double(board.size() * board[0].size());
+    double same{ 0 };
+    for (int count : counts)
+    {
+        same += (count / cells) * (count / cells);
+    }
+    return Topology::Degree * same;
+}
+
+// Picks the engine for the board. The board-driven one pays O(tree nodes) per query for its
+// counters and a recursive call per letter, so it only wins when
+//   - branching nodes have many more children than a cell has neighbours, so one probe round per
+//     node beats one per child;
+//   - paths repeat (fanout >= 1) over a tree smaller than the board, where dead states pay off;
+//   - the board is huge and most of the tree is walked anyway.
+// Thresholds come from the random, few-letter and adversarial workloads of Workloads.hpp.
+template <typename Topology = Orthogonal>
+bool PreferBoardDriven(const SuffixTree& tree, const vector<vector<char>>& board)
+{
+    static constexpr size_t HugeBoardCells = 8192;
+
+    const size_t cells = board.size() * board[0].size();
+    if (cells >= HugeBoardCells)
+    {
+        return true;
+    }
+    if (tree.nodes.size() < cells && PathFanout<Topology>(board) >= 1)
+    {
+        return true;
+    }
+    uint64_t branching{ 0 };
+    uint64_t children{ 0 };
+    for (size_t i = 1; i < tree.nodes.size(); ++i)
+    {
+        if (tree.nodes[i].children_num > 1)
+        {
+            ++branching;
+            children += tree.nodes[i].children_num;
+        }
+    }
+    return branching && children > branching * Topology::Degree * 2;
+}
+
+// Runs the engine PreferBoardDriven picks. Like FindWordsDFS the tree is consumed either way.
+template <typename Topology = Orthogonal, typename Sink>
+void FindWordsAuto(SuffixTree& tree, const vector<vector<char>>& board, Sink&& sink)
+{
+    if (PreferBoardDriven<Topology>(tree, board))
+    {
+        BasicBoardWordFinder<Topology, Sink&> finder{ board, sink };
+        finder.FindWords(tree);
+    }
+    else
+    {
+        FindWordsDFS<Topology>(tree, board, sink);
+    }
+}
+
+// Words only, so from TiledBoardCells cells on the tiled search can run instead, on this thread.
+template <typename Topology = Orthogonal>
+void FindWordsAuto(SuffixTree& tree, const vector<vector<char>>& board, vector<string>& out)
+{
+    if (!Topology::Wraps && board.size() * board[0].size() >= TiledBoardCells)
+    {
+        FindWordsTiled<Topology>(tree, board, out, 1);
+        return;
+    }
+    FindWordsAuto<Topology>(tree, board, StringSink{ out });
+}
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include "SuffixTree.hpp"
+#include "BoardAdjacency.hpp"
+#include "DictionaryFile.hpp"
+#include "Grids.hpp"
+#include "ResultSink.hpp"
+#include "SearchLimits.hpp"
+
+using namespace std;
+
+// Board independent, immutable word index. Build it once and query it with any number of boards,
+// from any number of threads as long as every thread has its own DictionaryQuery.
+// It either owns a built SuffixTree or maps an index file written by Save().
+class Dictionary
+{
+public:
+    // Built with SuffixTree::BuildParallel on build_threads threads, 0 - every core.
+    Dictionary(const vector<string>& words, int build_threads = 0) :
+        m_alphabet(Alphabet::Latin())
+    {
+        m_tree.BuildParallel(words, build_threads);
+        m_word_count = m_tree.word_count;
+    }
+
+    // UTF-8 words in any alphabet, e.g. Alphabet{ words }. Boards have to be encoded with the same
+    // alphabet, Letters().Decode() turns found words back into UTF-8.
+    Dictionary(const Alphabet& alphabet, const vector<string>& words, int build_threads = 0) :
+        m_alphabet(alphabet)
+    {
+        m_tree.BuildParallel(alphabet.EncodeWords(words), build_threads);
+        m_word_count = m_tree.word_count;
+    }
+
+    static unique_ptr<Dictionary> Load(const string& path, bool verify_checksum = true)
+    {
+        unique_ptr<Dictionary> dictionary{ new Dictionary() };
+        dictionary->m_file.reset(new MappedFile(path));
+        dictionary->m_view = OpenDictionaryFile(*dictionary->m_file, verify_checksum, &dictionary->m_word_count, &dictionary->m_alphabet);
+        return dictionary;
+    }
+
+    void Save(const string& path) const
+    {
+        if (m_file)
+        {
+            throw runtime_error("dictionary is already backed by a file");
+        }
+        WriteDictionaryFile(m_tree, m_alphabet, path);
+    }
+
+    TrieView Tree() const
+    {
+        return m_file ? m_view : m_tree.View();
+    }
+
+    uint64_t WordCount() const
+    {
+        return m_word_count;
+    }
+
+    const Alphabet& Letters() const
+    {
+        return m_alphabet;
+    }
+
+private:
+    Dictionary() = default;
+
+    SuffixTree m_tree;
+    unique_ptr<MappedFile> m_file;
+    TrieView m_view;
+    uint64_t m_word_count{ 0 };
+    Alphabet m_alphabet;
+};
+
+// Node flags of one query, stamped with the query generation so nothing has to be cleared between
+// boards: a flag set by an earlier query reads as unset.
+class QueryStamps
+{
+public:
+    enum : uint32_t { Found = 1, Exhausted = 2, Live = 4, FlagBits = 3 };
+
+    void NextGeneration(size_t nodes_num)
+    {
+        if (m_stamps.size() != nodes_num || ++m_generation >= (1u << (32 - FlagBits)))
+        {
+            m_stamps.assign(nodes_num, 0);
+            m_generation = 1;
+        }
+    }
+
+    bool Has(uint32_t node_idx, uint32_t flag) const
+    {
+        return Flags(node_idx) & flag;
+    }
+
+    void Set(uint32_t node_idx, uint32_t flag)
+    {
+        m_stamps[node_idx] = (m_generation << FlagBits) | Flags(node_idx) | flag;
+    }
+
+private:
+    vector<uint32_t> m_stamps;
+    uint32_t m_generation{ 0 };
+
+    uint32_t Flags(uint32_t node_idx) const
+    {
+        const uint32_t stamp = m_stamps[node_idx];
+        return (stamp >> FlagBits) == m_generation ? stamp & ((1u << FlagBits) - 1) : 0;
+    }
+};
+
+// The filters of SuffixTree::Build, applied per edge while a query walks down the trie: a subtree
+// is skipped when its prefix needs more of some letter than the board has or has letters next to
+// each other that aren't. Enter and Leave pair up along the trie path.
+class EdgeFilter
+{
+public:
+    template <typename Topology>
+    void Set(const vector<vector<char>>& board)
+    {
+        m_adjacency.Set<Topology>(board);
+        memset(m_occ, 0, sizeof(m_occ));
+        memset(m_need, 0, sizeof(m_need));
+        for (auto& row : board)
+        {
+            for (char c : row)
+            {
+                ++m_occ[Symbol(c)];
+            }
+        }
+    }
+
+    bool Enter(const TrieView& tree, const Node& node)
+    {
+        if (!m_adjacency.Fits(tree.pattern(node), node.prefix_idx))
+        {
+            return false;
+        }
+        const string_view edge{ tree.get_pattern(node) };
+        for (size_t i = 0; i < edge.size(); ++i)
+        {
+            if (++m_need[Symbol(edge[i])] > m_occ[Symbol(edge[i])])
+            {
+                for (size_t j = 0; j <= i; ++j)
+                {
+                    --m_need[Symbol(edge[j])];
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Leave(const TrieView& tree, const Node& node)
+    {
+        for (char c : tree.get_pattern(node))
+        {
+            --m_need[Symbol(c)];
+        }
+    }
+
+    // Enter without the path: the letters are counted over the node's whole pattern, for searches
+    // that check a node once and keep the result.
+    bool Fits(const TrieView& tree, const Node& node) const
+    {
+        const string_view pattern{ tree.pattern(node) };
+        if (!m_adjacency.Fits(pattern, node.prefix_idx))
+        {
+            return false;
+        }
+        for (size_t i = node.prefix_idx; i < pattern.size(); ++i)
+        {
+            if (count(pattern.begin(), pattern.begin() + i + 1, pattern[i]) > m_occ[Symbol(pattern[i])])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    BoardAdjacency m_adjacency;
+    int m_occ[MaxSymbols];  // symbols on the board
+    int m_need[MaxSymbols]; // symbols used by the current trie path
+};
+
+// Per-query scratch state. Instead of pruning the tree like DFSWordFinder, found words and fully
+// found subtrees are stamped with the query generation, so nothing has to be cleared between
+// boards and the dictionary is never written to. Grid is one of the board layouts in Grids.hpp.
+template <typename Grid>
+class BasicDictionaryQuery
+{
+public:
+    SearchStatus FindWords(const Dictionary& dictionary, const vector<vector<char>>& board, vector<string>& out, const SearchLimits& limits = {})
+    {
+        return FindWords(dictionary, board, StringSink{ out }, limits);
+    }
+
+    // Reports to a sink of ResultSink.hpp, word ids are node ids of the dictionary. Stops early at
+    // the limits; the stamps of a stopped query are dropped with its generation.
+    template <typename Sink>
+    SearchStatus FindWords(const Dictionary& dictionary, const vector<vector<char>>& board, Sink&& sink, const SearchLimits& limits = {})
+    {
+        WORDSEARCH_PROFILE_SCOPE("query_search");
+        m_tree = dictionary.Tree();
+        CheckBoard(board);
+        m_stamps.NextGeneration(m_tree.nodes_num);
+        m_live.resize(m_tree.nodes_num);
+        m_grid.Set(board);
+        m_filter.Set<typename Grid::GridTopology>(board);
+        m_budget.Start(limits, uint32_t(board.size() * board[0].size()));
+
+        for (int i = 0; i < m_grid.size() && !m_budget.Stopped(); ++i)
+        {
+            const char cell_char = m_grid.letter(i);
+            if (!cell_char)
+            {
+                continue;
+            }
+            if (const uint32_t Root = m_tree.Roots[Symbol(cell_char)])
+            {
+                const Node& root{ m_tree.nodes[Root] };
+                if (m_stamps.Has(Root, QueryStamps::Exhausted) || !m_filter.Enter(m_tree, root))
+                {
+                    m_stamps.Set(Root, QueryStamps::Exhausted);
+                    m_budget.CellSearched();
+                    continue;
+                }
+                m_path.clear();
+                m_path.push_back(i);
+                m_grid.Visit(i);
+                search_impl(sink, root, m_tree.pattern(root), 1);
+                m_grid.Unvisit(i);
+                m_filter.Leave(m_tree, root);
+            }
+            if (!m_budget.Stopped())
+            {
+                m_budget.CellSearched();
+            }
+        }
+        return m_budget.Status();
+    }
+
+private:
+    TrieView m_tree;
+    QueryStamps m_stamps;
+    vector<uint64_t> m_live; // children that may still have words, valid with the Live flag
+    Grid m_grid;
+    vector<int> m_path;
+    vector<int> m_board_path; // m_path in board cells, for the sink
+    EdgeFilter m_filter;
+    SearchBudget m_budget;
+
+    // Walks the rest of the node's edge over the board. Returns true once every word below node
+    // has been reported.
+    template <typename Sink>
+    bool search_impl(Sink& sink, const Node& node, const string_view& node_pattern, const int idx)
+    {
+        if (idx == (int)node_pattern.size())
+        {
+            return visit(sink, node, idx);
+        }
+
+        if (m_budget.Step())
+        {
+            return false;
+        }
+        bool exhausted{ false };
+        WORDSEARCH_COUNT(NeighborProbes);
+        m_grid.ForEachNeighbor(m_path.back(), node_pattern[idx], [&](int neighbor)
+        {
+            m_grid.Visit(neighbor);
+            m_path.push_back(neighbor);
+            exhausted = search_impl(sink, node, node_pattern, idx + 1);
+            m_path.pop_back();
+            m_grid.Unvisit(neighbor);
+            WORDSEARCH_COUNT(Backtracks);
+            return !exhausted && !m_budget.Stopped();
+        });
+        return exhausted;
+    }
+
+    template <typename Sink>
+    bool visit(Sink& sink, const Node& node, const int idx)
+    {
+        const uint32_t node_idx = m_tree.index(node);
+        if (m_stamps.Has(node_idx, QueryStamps::Exhausted))
+        {
+            return true;
+        }
+        WORDSEARCH_COUNT(NodesVisited);
+        if (node.mask > 0 && !m_stamps.Has(node_idx, QueryStamps::Found))
+        {
+            m_stamps.Set(node_idx, QueryStamps::Found);
+            m_board_path.resize(m_path.size());
+            for (size_t k = 0; k < m_path.size(); ++k)
+            {
+                m_board_path[k] = m_grid.BoardCell(m_path[k]);
+            }
+            ReportWords(sink, node_idx, m_budget.Take(node.mask), m_tree.pattern(node), m_board_path.data(), (int)m_board_path.size());
+        }
+        // Children that are exhausted or can't be on this board are dropped from the live mask, so
+        // the next path that reaches this node only looks at the rest.
+        if (!m_stamps.Has(node_idx, QueryStamps::Live))
+        {
+            m_live[node_idx] = node.children_mask;
+            m_stamps.Set(node_idx, QueryStamps::Live);
+        }
+        uint64_t& live{ m_live[node_idx] };
+        uint64_t pending{ live };
+        while (pending && !m_budget.Stopped())
+        {
+            const int c = ctz64(pending);
+            pending &= pending - 1;
+            const Node& child{ m_tree.nodes[m_tree.child_pool[node.children + node.child_slot(c)]] };
+            if (!m_filter.Enter(m_tree, child))
+            {
+                live &= ~(uint64_t(1) << c);
+                continue;
+            }
+            if (search_impl(sink, child, m_tree.pattern(child), idx))
+            {
+                live &= ~(uint64_t(1) << c);
+            }
+            m_filter.Leave(m_tree, child);
+        }
+        const bool exhausted{ live == 0 };
+        if (exhausted)
+        {
+            m_stamps.Set(node_idx, QueryStamps::Exhausted);
+        }
+        return exhausted;
+    }
+};
+
+using DictionaryQuery = BasicDictionaryQuery<CellGrid>;
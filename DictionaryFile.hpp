@@ -0,0 +1,302 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "SuffixTree.hpp"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// On-disk layout of a built tree:
+//   DictionaryFileHeader | nodes | child_pool | text
+// Every section starts at an 8-byte aligned offset from the start of the file and the arrays are
+// stored exactly as they are in memory (little-endian), so a mapped file is used as is. The
+// checksum covers the whole file, the header with its checksum field zeroed included.
+struct DictionaryFileHeader
+{
+    static constexpr char Magic[8] = { 'W', 'S', 'D', 'I', 'C', 'T', '\0', '\0' };
+    static constexpr uint32_t Version = 3;
+    static constexpr uint32_t Endianness = 0x01020304;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t endianness;
+    uint32_t header_size;
+    uint32_t node_size;
+    uint32_t alphabet_size;
+    int32_t alphabet[MaxSymbols]; // code point of every symbol
+    uint32_t Roots[MaxSymbols];
+    uint64_t word_count;
+    uint64_t nodes_offset;
+    uint64_t nodes_num;
+    uint64_t child_pool_offset;
+    uint64_t child_pool_size;
+    uint64_t text_offset;
+    uint64_t text_size;
+    uint64_t checksum; // FNV-1a over the file with this field zeroed
+};
+
+static_assert(is_trivially_copyable<Node>::value, "Node is written to disk as is");
+static_assert(has_unique_object_representations<Node>::value, "Node has no padding to write uninitialized");
+
+inline uint64_t fnv1a(const char* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t align8(uint64_t offset)
+{
+    return (offset + 7) & ~uint64_t(7);
+}
+
+// The header bytes, padding included, hashed with the checksum field zeroed: the start of the
+// file's checksum.
+inline uint64_t HeaderChecksum(const char* header)
+{
+    char bytes[sizeof(DictionaryFileHeader)];
+    memcpy(bytes, header, sizeof(bytes));
+    memset(bytes + offsetof(DictionaryFileHeader, checksum), 0, sizeof(uint64_t));
+    return fnv1a(bytes, sizeof(bytes));
+}
+
+// end = offset + count * size, false if that doesn't fit in 64 bits.
+inline bool SectionEnd(uint64_t offset, uint64_t count, uint64_t size, uint64_t& end)
+{
+    if (count > (UINT64_MAX - offset) / size)
+    {
+        return false;
+    }
+    end = offset + count * size;
+    return true;
+}
+
+inline void WriteDictionaryFile(const SuffixTree& tree, const Alphabet& alphabet, const string& path)
+{
+    DictionaryFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DictionaryFileHeader::Magic, sizeof(header.magic));
+    header.version = DictionaryFileHeader::Version;
+    header.endianness = DictionaryFileHeader::Endianness;
+    header.header_size = sizeof(DictionaryFileHeader);
+    header.node_size = sizeof(Node);
+    header.alphabet_size = alphabet.size();
+    for (int i = 0; i < alphabet.size(); ++i)
+    {
+        header.alphabet[i] = alphabet.Letter(i);
+    }
+    copy(tree.Roots, tree.Roots + MaxSymbols, header.Roots);
+    header.word_count = tree.word_count;
+    header.nodes_num = tree.nodes.size();
+    header.child_pool_size = tree.child_pool.size();
+    header.text_size = tree.text.size();
+    header.nodes_offset = align8(sizeof(DictionaryFileHeader));
+    header.child_pool_offset = align8(header.nodes_offset + header.nodes_num * sizeof(Node));
+    header.text_offset = align8(header.child_pool_offset + header.child_pool_size * sizeof(uint32_t));
+
+    struct Section
+    {
+        uint64_t offset;
+        const char* data;
+        size_t size;
+    };
+    const Section sections[] = {
+        { header.nodes_offset, (const char*)tree.nodes.data(), tree.nodes.size() * sizeof(Node) },
+        { header.child_pool_offset, (const char*)tree.child_pool.data(), tree.child_pool.size() * sizeof(uint32_t) },
+        { header.text_offset, tree.text.data(), tree.text.size() },
+    };
+
+    // The checksum covers the padding too, so the loader can hash the mapped range in one go.
+    const char zeros[8] = {};
+    uint64_t position = sizeof(DictionaryFileHeader);
+    uint64_t checksum = HeaderChecksum((const char*)&header);
+    for (auto& section : sections)
+    {
+        checksum = fnv1a(zeros, size_t(section.offset - position), checksum);
+        checksum = fnv1a(section.data, section.size, checksum);
+        position = section.offset + section.size;
+    }
+    header.checksum = checksum;
+
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file)
+    {
+        throw runtime_error("can't open " + path + " for writing");
+    }
+    file.write((const char*)&header, sizeof(header));
+    position = sizeof(DictionaryFileHeader);
+    for (auto& section : sections)
+    {
+        file.write(zeros, size_t(section.offset - position));
+        file.write(section.data, section.size);
+        position = section.offset + section.size;
+    }
+    if (!file)
+    {
+        throw runtime_error("failed to write " + path);
+    }
+}
+
+// Read-only mapping of a whole file.
+class MappedFile
+{
+public:
+    MappedFile(const string& path)
+    {
+#if defined(_WIN32)
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            throw runtime_error("can't open " + path);
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size))
+        {
+            CloseHandle(m_file);
+            throw runtime_error("can't stat " + path);
+        }
+        m_size = (size_t)size.QuadPart;
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping)
+        {
+            CloseHandle(m_file);
+            throw runtime_error("can't map " + path);
+        }
+        m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw runtime_error("can't open " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            throw runtime_error("can't stat " + path);
+        }
+        m_size = (size_t)st.st_size;
+        void* data = m_size ? mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        m_data = data == MAP_FAILED ? nullptr : (const char*)data;
+#endif
+        if (!m_data)
+        {
+            throw runtime_error("can't map " + path);
+        }
+    }
+
+    ~MappedFile()
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+#else
+        munmap((void*)m_data, m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    const char* m_data{ nullptr };
+    size_t m_size{ 0 };
+#if defined(_WIN32)
+    HANDLE m_file{ INVALID_HANDLE_VALUE };
+    HANDLE m_mapping{ nullptr };
+#endif
+};
+
+// Validates the header of a mapped index and returns a view into it. Nothing is copied or parsed;
+// verify_checksum costs one pass over the file and can be skipped for trusted files. Without it the
+// section bounds and the roots are still checked, the nodes are not.
+inline TrieView OpenDictionaryFile(const MappedFile& file, bool verify_checksum, uint64_t* word_count = nullptr, Alphabet* alphabet = nullptr)
+{
+    if (file.size() < sizeof(DictionaryFileHeader))
+    {
+        throw runtime_error("dictionary file is truncated");
+    }
+    DictionaryFileHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, DictionaryFileHeader::Magic, sizeof(header.magic)) != 0)
+    {
+        throw runtime_error("not a dictionary file");
+    }
+    if (header.version != DictionaryFileHeader::Version || header.endianness != DictionaryFileHeader::Endianness ||
+        header.header_size != sizeof(DictionaryFileHeader) || header.node_size != sizeof(Node) || header.alphabet_size > MaxSymbols)
+    {
+        throw runtime_error("unsupported dictionary file version or layout");
+    }
+    uint64_t nodes_end;
+    uint64_t child_pool_end;
+    uint64_t text_end;
+    if (header.nodes_offset < sizeof(DictionaryFileHeader) || header.nodes_offset % alignof(Node) != 0 ||
+        header.child_pool_offset % alignof(uint32_t) != 0 || header.nodes_num == 0 || header.nodes_num > UINT32_MAX ||
+        !SectionEnd(header.nodes_offset, header.nodes_num, sizeof(Node), nodes_end) || nodes_end > header.child_pool_offset ||
+        !SectionEnd(header.child_pool_offset, header.child_pool_size, sizeof(uint32_t), child_pool_end) || child_pool_end > header.text_offset ||
+        !SectionEnd(header.text_offset, header.text_size, 1, text_end) || text_end != file.size())
+    {
+        throw runtime_error("dictionary file sections are inconsistent");
+    }
+    for (const uint32_t root : header.Roots)
+    {
+        if (root >= header.nodes_num)
+        {
+            throw runtime_error("dictionary file root out of range");
+        }
+    }
+    if (verify_checksum)
+    {
+        const uint64_t checksum = fnv1a(file.data() + sizeof(DictionaryFileHeader), file.size() - sizeof(DictionaryFileHeader), HeaderChecksum(file.data()));
+        if (checksum != header.checksum)
+        {
+            throw runtime_error("dictionary file checksum mismatch");
+        }
+    }
+
+    TrieView view;
+    view.nodes = (const Node*)(file.data() + header.nodes_offset);
+    view.nodes_num = (uint32_t)header.nodes_num;
+    view.child_pool = (const uint32_t*)(file.data() + header.child_pool_offset);
+    view.text = file.data() + header.text_offset;
+    copy(header.Roots, header.Roots + MaxSymbols, view.Roots);
+    if (word_count)
+    {
+        *word_count = header.word_count;
+    }
+    if (alphabet)
+    {
+        *alphabet = Alphabet::FromLetters(vector<int32_t>(header.alphabet, header.alphabet + header.alphabet_size));
+    }
+    return view;
+}
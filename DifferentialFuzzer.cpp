@@ -0,0 +1,1227 @@
+// Differential fuzzer for the search engines, separate from the demo and the benchmark:
+//
+//   g++ -std=c++17 -O2 -pthread DifferentialFuzzer.cpp -o wordsearch_fuzz    (or CMakeLists.txt)
+//   wordsearch_fuzz [--iterations N] [--seed N] [--max-side N] [--topology name] [--check text]
+//                   [--max-failures N] [--list]
+//   wordsearch_fuzz --topology name --board rows --words list      (replays one case)
+//
+// Every iteration makes a random board and dictionary for one topology (orthogonal, diagonal,
+// toroidal, hexagonal): duplicates, palindromes, words and their reversals, prefixes and extensions
+// of other words, walks over the board, single-letter boards, letters past 'z' and single rows with
+// words of up to 64 letters. A brute-force DFS per word is the reference, every engine and build
+// variant is compared with it, and a failing case is shrunk to a small one before it is printed,
+// ready to be replayed. The top-K query is checked against the reference sorted by score, a saved
+// and loaded index and the batch pipeline against the reference words. Copies of the case with
+// bytes outside the alphabet check that words with them are skipped and boards with them rejected.
+// The exit code is 1 if any check failed.
+//
+// Cases are printed one character per symbol, a-z, then A-Z, 0-9, '+' and '/' for the symbols past
+// 'z'; board rows are separated by '/' and words by ','.
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "SuffixTree.hpp"
+#include "WordFinder.hpp"
+#include "BoardWordFinder.hpp"
+#include "Dictionary.hpp"
+#include "IncrementalSearch.hpp"
+#include "ParallelWordFinder.hpp"
+#include "TiledWordFinder.hpp"
+#include "TopKQuery.hpp"
+#include "BatchPipeline.hpp"
+
+using namespace std;
+
+struct FuzzCase
+{
+    vector<vector<char>> board;
+    vector<string> words;
+};
+
+// One engine, or one property of a build, checked against the reference words. Returns what is
+// wrong, empty if the case passes or the check doesn't apply to it.
+struct FuzzCheck
+{
+    string name;
+    function<string(const FuzzCase&, const vector<string>& expected)> run;
+};
+
+struct FuzzOptions
+{
+    int iterations{ 10000 };
+    unsigned seed{ 1 };
+    int max_side{ 12 };
+    string topology;     // empty - all of them in turn
+    string check_filter; // substring of the check names
+    int max_failures{ 5 };
+    bool list{ false };
+    bool replay{ false };
+    FuzzCase replay_case;
+};
+
+const char PrintableSymbols[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789+/";
+static_assert(sizeof(PrintableSymbols) == MaxSymbols + 1, "one character per symbol");
+
+string Printable(const string& symbols)
+{
+    string out;
+    for (char c : symbols)
+    {
+        out += IsSymbol(c) ? PrintableSymbols[Symbol(c)] : '?';
+    }
+    return out;
+}
+
+bool ParseSymbols(const string& text, string& symbols)
+{
+    symbols.clear();
+    for (char c : text)
+    {
+        const char* found = find(PrintableSymbols, PrintableSymbols + MaxSymbols, c);
+        if (found == PrintableSymbols + MaxSymbols)
+        {
+            return false;
+        }
+        symbols += SymbolChar(int(found - PrintableSymbols));
+    }
+    return true;
+}
+
+string PrintableCase(const FuzzCase& fuzz_case)
+{
+    string out{ "--board " };
+    for (size_t i = 0; i < fuzz_case.board.size(); ++i)
+    {
+        out += (i ? "/" : "") + Printable(string(fuzz_case.board[i].begin(), fuzz_case.board[i].end()));
+    }
+    out += " --words ";
+    for (size_t i = 0; i < fuzz_case.words.size(); ++i)
+    {
+        out += (i ? "," : "") + Printable(fuzz_case.words[i]);
+    }
+    return out;
+}
+
+vector<string> Split(const string& text, char separator)
+{
+    vector<string> parts;
+    size_t start = 0;
+    for (size_t end; (end = text.find(separator, start)) != string::npos; start = end + 1)
+    {
+        parts.push_back(text.substr(start, end - start));
+    }
+    parts.push_back(text.substr(start));
+    return parts;
+}
+
+// Reference
+
+template <typename Topology>
+bool ReferenceWalk(const vector<vector<char>>& board, vector<uint8_t>& visited, const string& word, size_t k, int cell)
+{
+    const int m = (int)board.size();
+    const int n = (int)board[0].size();
+    if (visited[cell] || board[cell / n][cell % n] != word[k])
+    {
+        return false;
+    }
+    if (k + 1 == word.size())
+    {
+        return true;
+    }
+    visited[cell] = 1;
+    int neighbors[Topology::Degree];
+    NeighborCells<Topology>(cell / n, cell % n, m, n, neighbors);
+    bool found{ false };
+    for (int neighbor : neighbors)
+    {
+        if (neighbor >= 0 && ReferenceWalk<Topology>(board, visited, word, k + 1, neighbor))
+        {
+            found = true;
+            break;
+        }
+    }
+    visited[cell] = 0;
+    return found;
+}
+
+// Every distinct word that some path of distinct cells spells, sorted. Nothing shared with the
+// engines but Topology::Neighbor.
+template <typename Topology>
+vector<string> ReferenceWords(const FuzzCase& fuzz_case)
+{
+    const vector<vector<char>>& board{ fuzz_case.board };
+    const int cells = int(board.size() * board[0].size());
+    vector<uint8_t> visited(cells);
+    vector<string> found;
+    for (const string& word : fuzz_case.words)
+    {
+        for (int cell = 0; cell < cells && !word.empty(); ++cell)
+        {
+            if (ReferenceWalk<Topology>(board, visited, word, 0, cell))
+            {
+                found.push_back(word);
+                break;
+            }
+        }
+    }
+    sort(found.begin(), found.end());
+    found.erase(unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+// Engines must report every word once.
+string Compare(vector<string> found, const vector<string>& expected)
+{
+    sort(found.begin(), found.end());
+    if (found == expected)
+    {
+        return {};
+    }
+    vector<string> missing;
+    vector<string> unexpected;
+    set_difference(expected.begin(), expected.end(), found.begin(), found.end(), back_inserter(missing));
+    set_difference(found.begin(), found.end(), expected.begin(), expected.end(), back_inserter(unexpected));
+    auto list = [](const vector<string>& words)
+    {
+        string out;
+        for (size_t i = 0; i < words.size() && i < 8; ++i)
+        {
+            out += " " + Printable(words[i]);
+        }
+        return words.size() > 8 ? out + " ..." : out;
+    };
+    string why{ to_string(found.size()) + " words instead of " + to_string(expected.size()) };
+    if (!missing.empty())
+    {
+        why += ", missing" + list(missing);
+    }
+    if (!unexpected.empty())
+    {
+        why += ", unexpected or repeated" + list(unexpected);
+    }
+    return why;
+}
+
+// find(fuzz_case, found) returns false if the engine can't take the case.
+template <typename F>
+FuzzCheck Engine(string name, F find)
+{
+    return { move(name), [find](const FuzzCase& fuzz_case, const vector<string>& expected)
+    {
+        vector<string> found;
+        return find(fuzz_case, found) ? Compare(move(found), expected) : string{};
+    } };
+}
+
+// BuildParallel promises the same tree as Build, node for node.
+string CompareTrees(const SuffixTree& a, const SuffixTree& b)
+{
+    if (a.text != b.text || a.word_count != b.word_count || a.max_word_length != b.max_word_length)
+    {
+        return "different text or word counts";
+    }
+    if (!equal(a.Roots, a.Roots + MaxSymbols, b.Roots))
+    {
+        return "different roots";
+    }
+    if (a.nodes.size() != b.nodes.size() || a.child_pool != b.child_pool)
+    {
+        return to_string(a.nodes.size()) + " nodes instead of " + to_string(b.nodes.size()) + " or different children";
+    }
+    for (size_t i = 0; i < a.nodes.size(); ++i)
+    {
+        const Node& x{ a.nodes[i] };
+        const Node& y{ b.nodes[i] };
+        if (x.offset != y.offset || x.length != y.length || x.prefix_idx != y.prefix_idx || x.children_mask != y.children_mask
+            || x.children != y.children || x.mask != y.mask || x.children_num != y.children_num)
+        {
+            return "node " + to_string(i) + " differs";
+        }
+    }
+    return {};
+}
+
+// A search stopped by SearchLimits: at most max_results distinct words that are all in the
+// reference, the status agreeing with them, and everything when the search completed.
+string CompareLimited(vector<string> found, const SearchStatus& status, const vector<string>& expected, uint64_t max_results)
+{
+    if (!status.partial())
+    {
+        string why{ Compare(move(found), expected) };
+        if (why.empty() && status.cells_searched != status.cells)
+        {
+            why = "completed after " + to_string(status.cells_searched) + " of " + to_string(status.cells) + " cells";
+        }
+        return why;
+    }
+    sort(found.begin(), found.end());
+    if (adjacent_find(found.begin(), found.end()) != found.end() || !includes(expected.begin(), expected.end(), found.begin(), found.end()))
+    {
+        return "stopped with a repeated or wrong word";
+    }
+    if (status.results != found.size() || (max_results && found.size() > max_results))
+    {
+        return "stopped with " + to_string(found.size()) + " words, status says " + to_string(status.results);
+    }
+    if (status.stop == SearchStop::MaxResults && found.size() != max_results)
+    {
+        return "stopped for max_results " + to_string(max_results) + " with " + to_string(found.size()) + " words";
+    }
+    if (status.stop == SearchStop::Deadline && max_results)
+    {
+        return "deadline without one";
+    }
+    return {};
+}
+
+// Bytes that are not symbols: 'A' once aliased symbol 32, '`' and 'a' + MaxSymbols are next to
+// the symbol range.
+const char ForeignBytes[] = { '\0', '$', 'A', '`', char(97 + MaxSymbols), char(255) };
+
+// The case's words and a copy of each with one byte foreign, which every build has to skip.
+vector<string> WithForeignWords(const vector<string>& words)
+{
+    vector<string> mixed{ words };
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        if (!words[i].empty())
+        {
+            string word{ words[i] };
+            word[i % word.size()] = ForeignBytes[i % size(ForeignBytes)];
+            mixed.push_back(word);
+        }
+    }
+    return mixed;
+}
+
+// The best k words by length: as many as the reference has up to k, each in the reference and
+// with the score Score() gives it, best first, and no better word left out. Words with equal
+// scores can be any of them.
+string CompareTopK(const vector<string>& found, const BasicTopKQuery<CellGrid>& query, const vector<string>& expected, int k)
+{
+    vector<size_t> lengths;
+    for (const string& word : expected)
+    {
+        lengths.push_back(word.size());
+    }
+    sort(lengths.rbegin(), lengths.rend());
+    lengths.resize(min(lengths.size(), size_t(k)));
+    if (found.size() != lengths.size())
+    {
+        return "top " + to_string(k) + ": " + to_string(found.size()) + " words instead of " + to_string(lengths.size());
+    }
+    vector<string> sorted{ found };
+    sort(sorted.begin(), sorted.end());
+    if (adjacent_find(sorted.begin(), sorted.end()) != sorted.end() || !includes(expected.begin(), expected.end(), sorted.begin(), sorted.end()))
+    {
+        return "top " + to_string(k) + ": a repeated or wrong word";
+    }
+    for (size_t i = 0; i < found.size(); ++i)
+    {
+        if (found[i].size() != lengths[i] || query.Score(i) != int(lengths[i]))
+        {
+            return "top " + to_string(k) + ": word " + to_string(i) + " " + Printable(found[i]) + " scores " + to_string(query.Score(i))
+                + ", the reference has " + to_string(lengths[i]);
+        }
+    }
+    return {};
+}
+
+// The words of RunBatch's NDJSON lines, which hold nothing but a-z words.
+string ParseBatchWords(const string& line, vector<string>& words)
+{
+    const size_t start = line.find("\"words\":[");
+    const size_t end = line.rfind("]}");
+    if (start == string::npos || end == string::npos || end < start)
+    {
+        return "no words in " + line;
+    }
+    const string list{ line.substr(start + 9, end - start - 9) };
+    if (!list.empty())
+    {
+        for (const string& word : Split(list, ','))
+        {
+            if (word.size() < 2 || word.front() != '"' || word.back() != '"')
+            {
+                return "malformed word in " + line;
+            }
+            words.push_back(word.substr(1, word.size() - 2));
+        }
+    }
+    return {};
+}
+
+// Name of the first entry point that accepted the board instead of throwing, empty if none did.
+string AcceptsBoard(const vector<pair<string, function<void()>>>& entries)
+{
+    for (const auto& entry : entries)
+    {
+        try
+        {
+            entry.second();
+            return entry.first;
+        }
+        catch (const runtime_error&)
+        {
+        }
+    }
+    return {};
+}
+
+// Limits derived from the case: half of the words, the first word, or a deadline that has passed.
+template <typename Search>
+vector<FuzzCheck> LimitedChecks(const string& engine, Search search)
+{
+    vector<FuzzCheck> checks;
+    for (int kind = 0; kind < 3; ++kind)
+    {
+        const string name{ engine + (kind == 0 ? "_max_results" : kind == 1 ? "_exists_only" : "_past_deadline") };
+        checks.push_back({ name, [=](const FuzzCase& c, const vector<string>& expected)
+        {
+            SearchLimits limits;
+            if (kind == 0)
+            {
+                limits.max_results = max<size_t>(expected.size() / 2, 1);
+            }
+            else if (kind == 1)
+            {
+                limits.exists_only = true;
+            }
+            else
+            {
+                limits.deadline = SearchLimits::Clock::now();
+            }
+            vector<string> found;
+            const SearchStatus status{ search(c, found, limits) };
+            if (kind == 2 && (!found.empty() || status.stop != SearchStop::Deadline || status.cells_searched))
+            {
+                return string{ "searched past the deadline" };
+            }
+            return CompareLimited(move(found), status, expected, limits.MaxResults());
+        } });
+    }
+    return checks;
+}
+
+// Engines and builds
+
+template <typename Topology>
+vector<FuzzCheck> Checks()
+{
+    constexpr bool orthogonal{ is_same_v<Topology, Orthogonal> };
+    vector<FuzzCheck> checks;
+
+    auto built = [](const FuzzCase& fuzz_case, SuffixTree& tree)
+    {
+        tree.Build<Topology>(fuzz_case.words, fuzz_case.board);
+    };
+    checks.push_back(Engine("dfs", [=](const FuzzCase& c, vector<string>& out)
+    {
+        SuffixTree tree;
+        built(c, tree);
+        FindWordsDFS<Topology>(tree, c.board, out);
+        return true;
+    }));
+    checks.push_back(Engine("dfs_small", [=](const FuzzCase& c, vector<string>& out)
+    {
+        SuffixTree tree;
+        built(c, tree);
+        if (!BasicDFSWordFinder<15, 32, Topology>::Fits(c.board, tree))
+        {
+            return false;
+        }
+        BasicDFSWordFinder<15, 32, Topology> finder{ c.board, out };
+        finder.FindWords(tree);
+        return true;
+    }));
+    checks.push_back(Engine("dfs_medium", [=](const FuzzCase& c, vector<string>& out)
+    {
+        SuffixTree tree;
+        built(c, tree);
+        if (!BasicDFSWordFinder<255, 64, Topology>::Fits(c.board, tree))
+        {
+            return false;
+        }
+        BasicDFSWordFinder<255, 64, Topology> finder{ c.board, out };
+        finder.FindWords(tree);
+        return true;
+    }));
+    checks.push_back(Engine("dfs_dynamic", [=](const FuzzCase& c, vector<string>& out)
+    {
+        SuffixTree tree;
+        built(c, tree);
+        BasicDFSWordFinder<0, 0, Topology> finder{ c.board, out };
+        finder.FindWords(tree);
+        return true;
+    }));
+    checks.push_back(Engine("dfs_board_independent_build", [](const FuzzCase& c, vector<string>& out)
+    {
+        SuffixTree tree;
+        tree.Build(c.words);
+        FindWordsDFS<Topology>(tree, c.board, out);
+        return true;
+    }));
+    checks.push_back(Engine("dfs_parallel_build", [](const FuzzCase& c, vector<string>& out)
+    {
+        SuffixTree tree;
+        tree.BuildParallel<Topology>(c.words, c.board, 3);
+        FindWordsDFS<Topology>(tree, c.board, out);
+        return true;
+    }));
+    checks.push_back({ "parallel_build_tree", [](const FuzzCase& c, const vector<string>&)
+    {
+        SuffixTree serial;
+        SuffixTree parallel;
+        serial.Build(c.words);
+        parallel.BuildParallel(c.words, 3);
+        string why{ CompareTrees(parallel, serial) };
+        if (why.empty())
+        {
+            SuffixTree board_serial;
+            SuffixTree board_parallel;
+            board_serial.Build<Topology>(c.words, c.board);
+            board_parallel.BuildParallel<Topology>(c.words, c.board, 3);
+            why = CompareTrees(board_parallel, board_serial);
+        }
+        return why;
+    } });
+    checks.push_back(Engine("board", [=](const FuzzCase& c, vector<string>& out)
+    {
+        SuffixTree tree;
+        built(c, tree);
+        BasicBoardWordFinder<Topology> finder{ c.board, out };
+        finder.FindWords(tree);
+        return true;
+    }));
+    checks.push_back(Engine("auto", [=](const FuzzCase& c, vector<string>& out)
+    {
+        SuffixTree tree;
+        built(c, tree);
+        FindWordsAuto<Topology>(tree, c.board, out);
+        return true;
+    }));
+    for (int tile_side : { 1, 3, 0 })
+    {
+        checks.push_back(Engine("tiled_" + (tile_side ? to_string(tile_side) : string{ "default" }), [=](const FuzzCase& c, vector<string>& out)
+        {
+            SuffixTree tree;
+            built(c, tree);
+            FindWordsTiled<Topology>(tree, c.board, out, tile_side == 3 ? 2 : 1, tile_side);
+            return true;
+        }));
+    }
+    if constexpr (orthogonal)
+    {
+        checks.push_back(Engine("parallel", [=](const FuzzCase& c, vector<string>& out)
+        {
+            SuffixTree tree;
+            built(c, tree);
+            ParallelWordFinder finder{ c.board, out, 3 };
+            finder.FindWords(tree);
+            return true;
+        }));
+    }
+
+    for (FuzzCheck& check : LimitedChecks("dfs", [=](const FuzzCase& c, vector<string>& out, const SearchLimits& limits)
+    {
+        SuffixTree tree;
+        built(c, tree);
+        return FindWordsDFS<Topology>(tree, c.board, out, limits);
+    }))
+    {
+        checks.push_back(move(check));
+    }
+    for (FuzzCheck& check : LimitedChecks("dictionary", [](const FuzzCase& c, vector<string>& out, const SearchLimits& limits)
+    {
+        const Dictionary dictionary{ c.words, 1 };
+        BasicDictionaryQuery<BasicCellGrid<Topology>> query;
+        return query.FindWords(dictionary, c.board, out, limits);
+    }))
+    {
+        checks.push_back(move(check));
+    }
+    // A stopped query must not leave marks behind for the next one on the same query object.
+    checks.push_back(Engine("dictionary_after_exists_only", [](const FuzzCase& c, vector<string>& out)
+    {
+        const Dictionary dictionary{ c.words, 1 };
+        BasicDictionaryQuery<BasicCellGrid<Topology>> query;
+        SearchLimits limits;
+        limits.exists_only = true;
+        vector<string> first;
+        query.FindWords(dictionary, c.board, first, limits);
+        query.FindWords(dictionary, c.board, out);
+        return true;
+    }));
+
+    // Two queries on one query object, the second one reuses its marks.
+    checks.push_back({ "dictionary", [](const FuzzCase& c, const vector<string>& expected)
+    {
+        const Dictionary dictionary{ c.words, 2 };
+        BasicDictionaryQuery<BasicCellGrid<Topology>> query;
+        for (int round = 0; round < 2; ++round)
+        {
+            vector<string> found;
+            query.FindWords(dictionary, c.board, found);
+            string why{ Compare(move(found), expected) };
+            if (!why.empty())
+            {
+                return round ? "second query: " + why : why;
+            }
+        }
+        return string{};
+    } });
+    if constexpr (orthogonal)
+    {
+        checks.push_back(Engine("dictionary_bitboard", [](const FuzzCase& c, vector<string>& out)
+        {
+            if (!BitboardGrid::Fits(c.board))
+            {
+                return false;
+            }
+            const Dictionary dictionary{ c.words, 1 };
+            BasicDictionaryQuery<BitboardGrid> query;
+            query.FindWords(dictionary, c.board, out);
+            return true;
+        }));
+        checks.push_back(Engine("dictionary_row_bitboard", [](const FuzzCase& c, vector<string>& out)
+        {
+            if (!RowBitboardGrid::Fits(c.board))
+            {
+                return false;
+            }
+            const Dictionary dictionary{ c.words, 1 };
+            BasicDictionaryQuery<RowBitboardGrid> query;
+            query.FindWords(dictionary, c.board, out);
+            return true;
+        }));
+    }
+    checks.push_back(Engine("top_k_all", [](const FuzzCase& c, vector<string>& out)
+    {
+        const Dictionary dictionary{ c.words, 1 };
+        const ScoreBounds bounds{ dictionary.Tree(), LetterScores::Length() };
+        BasicTopKQuery<BasicCellGrid<Topology>> query;
+        query.FindTopWords(dictionary, bounds, c.board, int(c.words.size()) + 1, out);
+        return true;
+    }));
+    if constexpr (orthogonal)
+    {
+        checks.push_back({ "top_k", [](const FuzzCase& c, const vector<string>& expected)
+        {
+            const Dictionary dictionary{ c.words, 1 };
+            const ScoreBounds bounds{ dictionary.Tree(), LetterScores::Length() };
+            TopKQuery query;
+            // The last k is more than the board has words: the search has to end once they are found.
+            for (int k : { 1, 2, 3, 4, int(expected.size()) + 3 })
+            {
+                vector<string> found;
+                query.FindTopWords(dictionary, bounds, c.board, k, found);
+                string why{ CompareTopK(found, query, expected, k) };
+                if (!why.empty())
+                {
+                    return why;
+                }
+            }
+            return string{};
+        } });
+        // The index file round trip, queried as mapped, with and without the checksum pass.
+        checks.push_back({ "save_load", [](const FuzzCase& c, const vector<string>& expected)
+        {
+            static const filesystem::path path{ filesystem::temp_directory_path() / ("wordsearch_fuzz_" + to_string(random_device{}()) + ".idx") };
+            Dictionary{ c.words, 1 }.Save(path.string());
+            string why;
+            for (bool verify : { true, false })
+            {
+                const unique_ptr<Dictionary> dictionary{ Dictionary::Load(path.string(), verify) };
+                DictionaryQuery query;
+                vector<string> found;
+                query.FindWords(*dictionary, c.board, found);
+                why = Compare(move(found), expected);
+                if (!why.empty() || dictionary->WordCount() != Dictionary{ c.words, 1 }.WordCount())
+                {
+                    why = (verify ? "verified load: " : "load: ") + (why.empty() ? string{ "different word count" } : why);
+                    break;
+                }
+            }
+            filesystem::remove(path);
+            return why;
+        } });
+        // The board as a '/' line and as a JSON line, both in the a-z alphabet of the batch
+        // dictionary; boards with symbols past 'z' are errors.
+        checks.push_back({ "batch", [](const FuzzCase& c, const vector<string>& expected)
+        {
+            const Dictionary dictionary{ c.words, 1 };
+            string slashed;
+            string rows;
+            bool latin{ true };
+            for (size_t i = 0; i < c.board.size(); ++i)
+            {
+                const string row{ c.board[i].begin(), c.board[i].end() };
+                latin = latin && all_of(row.begin(), row.end(), [](char x) { return x >= 'a' && x <= 'z'; });
+                slashed += (i ? "/" : "") + row;
+                rows += (i ? ",\"" : "\"") + row + "\"";
+            }
+            istringstream in{ slashed + "\n{\"id\": \"json\", \"board\": [" + rows + "]}\n" };
+            ostringstream out;
+            const BatchStats stats{ RunBatch(dictionary, in, out, { 2, 1, true }) };
+            if (stats.boards != 2 || stats.errors != (latin ? 0 : 2))
+            {
+                return to_string(stats.boards) + " boards with " + to_string(stats.errors) + " errors";
+            }
+            istringstream lines{ out.str() };
+            for (string line; getline(lines, line);)
+            {
+                vector<string> found;
+                string why{ latin ? ParseBatchWords(line, found) : string{} };
+                if (why.empty() && latin)
+                {
+                    why = Compare(move(found), expected);
+                }
+                if (!why.empty())
+                {
+                    return why;
+                }
+            }
+            return string{};
+        } });
+    }
+    // Starts from the board turned around and changes it into the case's board cell by cell.
+    checks.push_back(Engine("incremental", [](const FuzzCase& c, vector<string>& out)
+    {
+        const Dictionary dictionary{ c.words, 1 };
+        vector<vector<char>> start{ c.board.rbegin(), c.board.rend() };
+        for (auto& row : start)
+        {
+            reverse(row.begin(), row.end());
+        }
+        BasicIncrementalSearch<Topology> search{ dictionary, start };
+        vector<CellChange> changes;
+        for (int i = 0; i < (int)c.board.size(); ++i)
+        {
+            for (int j = 0; j < (int)c.board[0].size(); ++j)
+            {
+                if (start[i][j] != c.board[i][j])
+                {
+                    changes.push_back({ i, j, c.board[i][j] });
+                }
+            }
+        }
+        search.Update(changes);
+        search.Words(out);
+        return true;
+    }));
+    // The same changes with one cell outside the board at the end are rejected before any of them
+    // is applied: the search keeps the words of the start board and takes the changes after.
+    checks.push_back({ "incremental_outside", [](const FuzzCase& c, const vector<string>& expected)
+    {
+        const Dictionary dictionary{ c.words, 1 };
+        const int m = (int)c.board.size();
+        const int n = (int)c.board[0].size();
+        vector<vector<char>> start{ c.board.rbegin(), c.board.rend() };
+        for (auto& row : start)
+        {
+            reverse(row.begin(), row.end());
+        }
+        BasicIncrementalSearch<Topology> search{ dictionary, start };
+        vector<string> before;
+        search.Words(before);
+        sort(before.begin(), before.end());
+        vector<CellChange> changes;
+        for (int i = 0; i < m; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                changes.push_back({ i, j, c.board[i][j] });
+            }
+        }
+        for (const CellChange outside : { CellChange{ -1, 0, 'a' }, { m, 0, 'a' }, { 0, -1, 'a' }, { 0, n, 'a' } })
+        {
+            vector<CellChange> rejected{ changes };
+            rejected.push_back(outside);
+            vector<string> added;
+            try
+            {
+                search.Update(rejected, &added);
+                return "accepted cell " + to_string(outside.i) + "," + to_string(outside.j);
+            }
+            catch (const runtime_error&)
+            {
+            }
+            vector<string> found;
+            search.Words(found);
+            const string why{ Compare(move(found), before) };
+            if (!why.empty() || !added.empty())
+            {
+                return "rejected update changed the words: " + why;
+            }
+        }
+        search.Update(changes);
+        vector<string> found;
+        search.Words(found);
+        return Compare(move(found), expected);
+    } });
+
+    // Words with bytes outside the alphabet are skipped, the trees are the same without them.
+    checks.push_back({ "foreign_words_tree", [](const FuzzCase& c, const vector<string>&)
+    {
+        const vector<string> mixed{ WithForeignWords(c.words) };
+        SuffixTree clean;
+        SuffixTree serial;
+        SuffixTree parallel;
+        clean.Build(c.words);
+        serial.Build(mixed);
+        parallel.BuildParallel(mixed, 3);
+        string why{ CompareTrees(serial, clean) };
+        if (why.empty())
+        {
+            why = CompareTrees(parallel, clean);
+        }
+        if (why.empty())
+        {
+            SuffixTree board_clean;
+            SuffixTree board_mixed;
+            board_clean.Build<Topology>(c.words, c.board);
+            board_mixed.Build<Topology>(mixed, c.board);
+            why = CompareTrees(board_mixed, board_clean);
+        }
+        return why;
+    } });
+    checks.push_back(Engine("foreign_words_dictionary", [](const FuzzCase& c, vector<string>& out)
+    {
+        const Dictionary dictionary{ WithForeignWords(c.words), 1 };
+        BasicDictionaryQuery<BasicCellGrid<Topology>> query;
+        query.FindWords(dictionary, c.board, out);
+        return true;
+    }));
+    // A board with a byte outside the alphabet is rejected by every entry point.
+    checks.push_back({ "foreign_board", [](const FuzzCase& c, const vector<string>&)
+    {
+        const Dictionary dictionary{ c.words, 1 };
+        const ScoreBounds bounds{ dictionary.Tree(), LetterScores::Length() };
+        for (char foreign : ForeignBytes)
+        {
+            vector<vector<char>> board{ c.board };
+            board[board.size() / 2][board[0].size() / 2] = foreign;
+            vector<string> out;
+            vector<pair<string, function<void()>>> entries{
+                { "Build", [&] { SuffixTree tree; tree.Build<Topology>(c.words, board); } },
+                { "BuildParallel", [&] { SuffixTree tree; tree.BuildParallel<Topology>(c.words, board, 2); } },
+                { "dfs", [&] { SuffixTree tree; tree.Build(c.words); FindWordsDFS<Topology>(tree, board, out); } },
+                { "board", [&] { BasicBoardWordFinder<Topology> finder{ board, out }; } },
+                { "tiled", [&] { SuffixTree tree; tree.Build(c.words); FindWordsTiled<Topology>(tree, board, out, 1); } },
+                { "dictionary", [&] { BasicDictionaryQuery<BasicCellGrid<Topology>> query; query.FindWords(dictionary, board, out); } },
+                { "top_k", [&] { BasicTopKQuery<BasicCellGrid<Topology>> query; query.FindTopWords(dictionary, bounds, board, 3, out); } },
+                { "incremental", [&] { BasicIncrementalSearch<Topology> search{ dictionary, board }; } },
+                { "incremental_update", [&]
+                {
+                    BasicIncrementalSearch<Topology> search{ dictionary, c.board };
+                    search.Update({ { 0, 0, foreign } });
+                } },
+            };
+            if constexpr (is_same_v<Topology, Orthogonal>)
+            {
+                entries.push_back({ "parallel", [&] { ParallelWordFinder finder{ board, out, 2 }; } });
+            }
+            const string accepted{ AcceptsBoard(entries) };
+            if (!accepted.empty())
+            {
+                return accepted + " accepted byte " + to_string(uint8_t(foreign));
+            }
+        }
+        return string{};
+    } });
+    return checks;
+}
+
+// Cases
+
+template <typename Topology>
+string WalkWord(const vector<vector<char>>& board, int length, mt19937& rng)
+{
+    const int m = (int)board.size();
+    const int n = (int)board[0].size();
+    vector<uint8_t> visited(m * n);
+    int cell = rng() % (m * n);
+    string word;
+    while (true)
+    {
+        word += board[cell / n][cell % n];
+        visited[cell] = 1;
+        int neighbors[Topology::Degree];
+        NeighborCells<Topology>(cell / n, cell % n, m, n, neighbors);
+        int free[Topology::Degree];
+        int free_num{ 0 };
+        for (int neighbor : neighbors)
+        {
+            if (neighbor >= 0 && !visited[neighbor])
+            {
+                free[free_num++] = neighbor;
+            }
+        }
+        if ((int)word.size() >= length || free_num == 0)
+        {
+            return word;
+        }
+        cell = free[rng() % free_num];
+    }
+}
+
+template <typename Topology>
+FuzzCase MakeCase(mt19937& rng, int max_side)
+{
+    FuzzCase fuzz_case;
+    // Few letters make many matching paths, so those boards stay small enough for the reference.
+    const int letters = rng() % 8 == 0 ? 1 : 1 + rng() % 6;
+    const int side = letters <= 2 ? min(max_side, 4) : max_side;
+    int m = 1 + rng() % side;
+    int n = 1 + rng() % side;
+    // Now and then a single row or column with words past 32 letters, for the widest CommonPrefix
+    // loops; a path there has at most two ways to go, which keeps the reference fast.
+    const bool line = rng() % 8 == 0;
+    if (line)
+    {
+        m = 1;
+        n = 40 + rng() % 24;
+        if (rng() % 2)
+        {
+            swap(m, n);
+        }
+    }
+    // Mostly a-z, sometimes the symbols past 'z' up to the last one.
+    const int first = rng() % 4 == 0 ? rng() % (MaxSymbols - letters) : 0;
+    fuzz_case.board.assign(m, vector<char>(n));
+    for (auto& row : fuzz_case.board)
+    {
+        for (char& c : row)
+        {
+            c = SymbolChar(first + rng() % letters);
+        }
+    }
+
+    // One letter more than the board has, so some words can't be anywhere.
+    auto letter = [&] { return SymbolChar(first + rng() % (letters + 1)); };
+    const int max_length = line ? m * n : min(m * n + 2, 12);
+    vector<string>& words{ fuzz_case.words };
+    const int count = 1 + rng() % 40;
+    while ((int)words.size() < count)
+    {
+        const int kind = words.empty() ? 0 : rng() % 8;
+        const int length = 1 + rng() % max_length;
+        string word;
+        if (kind == 0)
+        {
+            for (int k = 0; k < length; ++k)
+            {
+                word += letter();
+            }
+        }
+        else if (kind == 1 || kind == 2)
+        {
+            word = WalkWord<Topology>(fuzz_case.board, length, rng);
+        }
+        else
+        {
+            const string& other{ words[rng() % words.size()] };
+            if (kind == 3)
+            {
+                word = other;
+            }
+            else if (kind == 4)
+            {
+                word.assign(other.rbegin(), other.rend());
+            }
+            else if (kind == 5)
+            {
+                word = other.substr(0, 1 + rng() % other.size());
+            }
+            else if (kind == 6)
+            {
+                word = other + letter();
+            }
+            else
+            {
+                word = other.substr(0, max<size_t>(other.size() / 2, 1));
+                if (rng() % 2)
+                {
+                    word += letter();
+                }
+                word.append(other.rend() - max<size_t>(other.size() / 2, 1), other.rend());
+            }
+        }
+        words.push_back(word);
+    }
+    return fuzz_case;
+}
+
+// Shrinks a failing case while the check keeps failing: drops words, rows and columns, shortens
+// words and makes board letters equal.
+template <typename Topology>
+FuzzCase Minimize(FuzzCase fuzz_case, const FuzzCheck& check)
+{
+    int attempts{ 0 };
+    auto fails = [&](const FuzzCase& candidate)
+    {
+        ++attempts;
+        return !check.run(candidate, ReferenceWords<Topology>(candidate)).empty();
+    };
+    for (bool progress = true; progress && attempts < 20000;)
+    {
+        progress = false;
+        for (size_t chunk = max<size_t>(fuzz_case.words.size() / 2, 1); chunk >= 1; chunk /= 2)
+        {
+            for (size_t start = 0; start < fuzz_case.words.size() && fuzz_case.words.size() > 1;)
+            {
+                FuzzCase candidate{ fuzz_case };
+                auto from = candidate.words.begin() + start;
+                candidate.words.erase(from, from + min(chunk, candidate.words.size() - start));
+                if (!candidate.words.empty() && fails(candidate))
+                {
+                    fuzz_case = move(candidate);
+                    progress = true;
+                }
+                else
+                {
+                    start += chunk;
+                }
+            }
+        }
+        for (int edge = 0; edge < 4; ++edge)
+        {
+            while (true)
+            {
+                FuzzCase candidate{ fuzz_case };
+                vector<vector<char>>& board{ candidate.board };
+                if (edge < 2 && board.size() > 1)
+                {
+                    board.erase(edge == 0 ? board.begin() : board.end() - 1);
+                }
+                else if (edge >= 2 && board[0].size() > 1)
+                {
+                    for (auto& row : board)
+                    {
+                        row.erase(edge == 2 ? row.begin() : row.end() - 1);
+                    }
+                }
+                else
+                {
+                    break;
+                }
+                if (!fails(candidate))
+                {
+                    break;
+                }
+                fuzz_case = move(candidate);
+                progress = true;
+            }
+        }
+        for (size_t w = 0; w < fuzz_case.words.size(); ++w)
+        {
+            for (int end = 0; end < 2; ++end)
+            {
+                while (fuzz_case.words[w].size() > 1)
+                {
+                    FuzzCase candidate{ fuzz_case };
+                    string& word{ candidate.words[w] };
+                    word.erase(end == 0 ? word.end() - 1 : word.begin());
+                    if (!fails(candidate))
+                    {
+                        break;
+                    }
+                    fuzz_case = move(candidate);
+                    progress = true;
+                }
+            }
+        }
+        const char lowest{ *min_element(fuzz_case.board[0].begin(), fuzz_case.board[0].end()) };
+        for (auto& row : fuzz_case.board)
+        {
+            for (char& c : row)
+            {
+                if (c == lowest)
+                {
+                    continue;
+                }
+                const char previous{ c };
+                c = lowest;
+                if (fails(fuzz_case))
+                {
+                    progress = true;
+                }
+                else
+                {
+                    c = previous;
+                }
+            }
+        }
+    }
+    return fuzz_case;
+}
+
+// Runs the checks on one case, prints and minimizes the failures. Returns how many failed.
+template <typename Topology>
+int RunChecks(const vector<FuzzCheck>& checks, const FuzzCase& fuzz_case, const char* topology, const string& label, const FuzzOptions& options)
+{
+    const vector<string> expected{ ReferenceWords<Topology>(fuzz_case) };
+    int failures{ 0 };
+    for (const FuzzCheck& check : checks)
+    {
+        if (check.name.find(options.check_filter) == string::npos)
+        {
+            continue;
+        }
+        const string why{ check.run(fuzz_case, expected) };
+        if (why.empty())
+        {
+            continue;
+        }
+        ++failures;
+        cout << "FAIL " << check.name << " on " << topology << " (" << label << "): " << why << endl;
+        const FuzzCase minimized{ options.replay ? fuzz_case : Minimize<Topology>(fuzz_case, check) };
+        cout << "  " << check.run(minimized, ReferenceWords<Topology>(minimized)) << endl;
+        cout << "  wordsearch_fuzz --topology " << topology << " --check " << check.name << " " << PrintableCase(minimized) << endl;
+    }
+    return failures;
+}
+
+template <typename Topology>
+int Fuzz(const char* topology, int iteration, mt19937& rng, const FuzzOptions& options)
+{
+    static const vector<FuzzCheck> checks{ Checks<Topology>() };
+    if (options.list)
+    {
+        for (const FuzzCheck& check : checks)
+        {
+            cout << topology << " " << check.name << endl;
+        }
+        return 0;
+    }
+    if (options.replay)
+    {
+        return RunChecks<Topology>(checks, options.replay_case, topology, "replay", options);
+    }
+    const FuzzCase fuzz_case{ MakeCase<Topology>(rng, options.max_side) };
+    return RunChecks<Topology>(checks, fuzz_case, topology, "seed " + to_string(options.seed) + ", iteration " + to_string(iteration), options);
+}
+
+int main(int argc, char** argv)
+{
+    FuzzOptions options;
+    string board_text;
+    string words_text;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg{ argv[i] };
+        const bool has_value{ i + 1 < argc };
+        if (arg == "--iterations" && has_value)
+        {
+            options.iterations = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--seed" && has_value)
+        {
+            options.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--max-side" && has_value)
+        {
+            options.max_side = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--topology" && has_value)
+        {
+            options.topology = argv[++i];
+        }
+        else if (arg == "--check" && has_value)
+        {
+            options.check_filter = argv[++i];
+        }
+        else if (arg == "--max-failures" && has_value)
+        {
+            options.max_failures = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--list")
+        {
+            options.list = true;
+        }
+        else if (arg == "--board" && has_value)
+        {
+            board_text = argv[++i];
+        }
+        else if (arg == "--words" && has_value)
+        {
+            words_text = argv[++i];
+        }
+        else
+        {
+            cerr << "unknown argument " << arg << endl;
+            return 2;
+        }
+    }
+
+    const vector<string> topologies{ "orthogonal", "diagonal", "toroidal", "hexagonal" };
+    if (!options.topology.empty() && find(topologies.begin(), topologies.end(), options.topology) == topologies.end())
+    {
+        cerr << "unknown topology " << options.topology << endl;
+        return 2;
+    }
+    if (!board_text.empty() || !words_text.empty())
+    {
+        options.replay = true;
+        string symbols;
+        for (const string& row : Split(board_text, '/'))
+        {
+            if (!ParseSymbols(row, symbols) || symbols.empty()
+                || (!options.replay_case.board.empty() && symbols.size() != options.replay_case.board[0].size()))
+            {
+                cerr << "--board needs rows of equal length separated by '/'" << endl;
+                return 2;
+            }
+            options.replay_case.board.emplace_back(symbols.begin(), symbols.end());
+        }
+        for (const string& word : Split(words_text, ','))
+        {
+            if (!ParseSymbols(word, symbols))
+            {
+                cerr << "--words has a letter outside " << PrintableSymbols << endl;
+                return 2;
+            }
+            options.replay_case.words.push_back(symbols);
+        }
+    }
+
+    mt19937 rng{ options.seed };
+    int failures{ 0 };
+    const int iterations{ options.list || options.replay ? 1 : options.iterations };
+    int iteration{ 0 };
+    for (; iteration < iterations && failures < options.max_failures; ++iteration)
+    {
+        for (size_t t = 0; t < topologies.size() && failures < options.max_failures; ++t)
+        {
+            const char* topology{ topologies[t].c_str() };
+            if (options.topology.empty() ? !(options.list || options.replay) && t != iteration % topologies.size() : options.topology != topology)
+            {
+                continue;
+            }
+            switch (t)
+            {
+            case 0: failures += Fuzz<Orthogonal>(topology, iteration, rng, options); break;
+            case 1: failures += Fuzz<Diagonal>(topology, iteration, rng, options); break;
+            case 2: failures += Fuzz<Toroidal>(topology, iteration, rng, options); break;
+            default: failures += Fuzz<Hexagonal>(topology, iteration, rng, options); break;
+            }
+        }
+    }
+    if (!options.list)
+    {
+        cout << (failures ? to_string(failures) + " failed checks" : "all checks passed") << " ("
+            << (options.replay ? string{ "replay" } : to_string(iteration) + " cases") << ")" << endl;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Simd.hpp"
+#include "Topology.hpp"
+
+using namespace std;
+
+// Board representations for BasicDictionaryQuery. A grid owns the visited state and answers
+// "which unvisited neighbours of cell carry letter p". Cell ids are grid specific; letter(cell) is
+// 0 for ids that are not on the board.
+//
+//   using GridTopology;                      // adjacency, see Topology.hpp
+//   void Set(const vector<vector<char>>& board);
+//   int size() const;                        // cell ids are [0, size())
+//   char letter(int cell) const;
+//   int BoardCell(int cell) const;           // i * n + j of the cell
+//   void Visit(int cell); void Unvisit(int cell);
+//   template <typename F> void ForEachNeighbor(int cell, char p, F&& f); // stops when f returns false
+
+template <typename F>
+inline bool ForEachBit(uint64_t bits, int base, F&& f)
+{
+    while (bits)
+    {
+        if (!f(base + ctz64(bits)))
+        {
+            return false;
+        }
+        bits &= bits - 1;
+    }
+    return true;
+}
+
+// Board copy where visited cells are overwritten with '$', plus a precomputed neighbour table.
+// The only grid that takes a Topology, the bitboards below are orthogonal.
+template <typename Topology>
+struct BasicCellGrid
+{
+    using GridTopology = Topology;
+
+    vector<char> letters;
+    vector<char> marks;
+    vector<array<int, Topology::Degree>> neighbors;
+
+    void Set(const vector<vector<char>>& board)
+    {
+        const int m = (int)board.size();
+        const int n = (int)board[0].size();
+        letters.resize(m * n);
+        neighbors.resize(m * n);
+        for (int i = 0; i < m; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                const int idx = i * n + j;
+                letters[idx] = board[i][j];
+                int cells[Topology::Degree];
+                NeighborCells<Topology>(i, j, m, n, cells);
+                copy(cells, cells + Topology::Degree, neighbors[idx].begin());
+            }
+        }
+        marks = letters;
+    }
+
+    int size() const
+    {
+        return (int)letters.size();
+    }
+
+    char letter(int cell) const
+    {
+        return letters[cell];
+    }
+
+    int BoardCell(int cell) const
+    {
+        return cell;
+    }
+
+    void Visit(int cell)
+    {
+        marks[cell] = '$';
+    }
+
+    void Unvisit(int cell)
+    {
+        marks[cell] = letters[cell];
+    }
+
+    template <typename F>
+    void ForEachNeighbor(int cell, char p, F&& f)
+    {
+        const array<int, Topology::Degree>& cells{ neighbors[cell] };
+        ForEachSlot<Topology::Degree>(0, [&](int slot)
+        {
+            const int neighbor = cells[slot];
+            return neighbor < 0 || marks[neighbor] != p || f(neighbor);
+        });
+    }
+};
+
+using CellGrid = BasicCellGrid<Orthogonal>;
+
+// Boards of up to 64 cells: the visited set, the neighbourhood of every cell and the cells of every
+// letter are single 64-bit masks, so the candidates are one AND.
+struct BitboardGrid
+{
+    using GridTopology = Orthogonal;
+    static constexpr int MaxCells = 64;
+
+    int cells{ 0 };
+    uint64_t visited{ 0 };
+    uint64_t letter_masks[MaxSymbols];
+    uint64_t neighbor_masks[MaxCells];
+    char letters[MaxCells];
+
+    static bool Fits(const vector<vector<char>>& board)
+    {
+        return board.size() * board[0].size() <= MaxCells;
+    }
+
+    void Set(const vector<vector<char>>& board)
+    {
+        const int m = (int)board.size();
+        const int n = (int)board[0].size();
+        cells = m * n;
+        visited = 0;
+        memset(letter_masks, 0, sizeof(letter_masks));
+        for (int i = 0; i < m; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                const int idx = i * n + j;
+                letters[idx] = board[i][j];
+                letter_masks[Symbol(board[i][j])] |= 1ull << idx;
+                uint64_t mask{ 0 };
+                if (j > 0) mask |= 1ull << (idx - 1);
+                if (j < n - 1) mask |= 1ull << (idx + 1);
+                if (i > 0) mask |= 1ull << (idx - n);
+                if (i < m - 1) mask |= 1ull << (idx + n);
+                neighbor_masks[idx] = mask;
+            }
+        }
+    }
+
+    int size() const
+    {
+        return cells;
+    }
+
+    char letter(int cell) const
+    {
+        return letters[cell];
+    }
+
+    int BoardCell(int cell) const
+    {
+        return cell;
+    }
+
+    void Visit(int cell)
+    {
+        visited |= 1ull << cell;
+    }
+
+    void Unvisit(int cell)
+    {
+        visited &= ~(1ull << cell);
+    }
+
+    template <typename F>
+    void ForEachNeighbor(int cell, char p, F&& f)
+    {
+        ForEachBit(neighbor_masks[cell] & letter_masks[Symbol(p)] & ~visited, 0, f);
+    }
+};
+
+// Boards up to 64 columns wide: one 64-bit visited word and one mask per letter for every row.
+// Cell id is row * 64 + column, so no division is needed to get back to the row.
+struct RowBitboardGrid
+{
+    using GridTopology = Orthogonal;
+    static constexpr int MaxWidth = 64;
+
+    int m{ 0 };
+    int n{ 0 };
+    vector<uint64_t> visited;
+    vector<uint64_t> letter_rows; // letter_rows[symbol * m + row]
+    vector<char> letters;
+
+    static bool Fits(const vector<vector<char>>& board)
+    {
+        return board[0].size() <= MaxWidth;
+    }
+
+    void Set(const vector<vector<char>>& board)
+    {
+        m = (int)board.size();
+        n = (int)board[0].size();
+        visited.assign(m, 0);
+        letter_rows.assign(MaxSymbols * m, 0);
+        letters.assign(m * MaxWidth, 0);
+        for (int i = 0; i < m; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                letters[i * MaxWidth + j] = board[i][j];
+                letter_rows[Symbol(board[i][j]) * m + i] |= 1ull << j;
+            }
+        }
+    }
+
+    int size() const
+    {
+        return m * MaxWidth;
+    }
+
+    char letter(int cell) const
+    {
+        return letters[cell];
+    }
+
+    int BoardCell(int cell) const
+    {
+        return (cell >> 6) * n + (cell & 63);
+    }
+
+    void Visit(int cell)
+    {
+        visited[cell >> 6] |= 1ull << (cell & 63);
+    }
+
+    void Unvisit(int cell)
+    {
+        visited[cell >> 6] &= ~(1ull << (cell & 63));
+    }
+
+    template <typename F>
+    void ForEachNeighbor(int cell, char p, F&& f)
+    {
+        const int row = cell >> 6;
+        const uint64_t bit = 1ull << (cell & 63);
+        const uint64_t* rows = &letter_rows[Symbol(p) * m];
+        if (row > 0 && !ForEachBit(rows[row - 1] & ~visited[row - 1] & bit, (row - 1) * MaxWidth, f))
+        {
+            return;
+        }
+        if (!ForEachBit(rows[row] & ~visited[row] & ((bit >> 1) | (bit << 1)), row * MaxWidth, f))
+        {
+            return;
+        }
+        if (row < m - 1)
+        {
+            ForEachBit(rows[row + 1] & ~visited[row + 1] & bit, (row + 1) * MaxWidth, f);
+        }
+    }
+};
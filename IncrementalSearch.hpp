@@ -0,0 +1,463 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Dictionary.hpp"
+#include "Grids.hpp"
+#include "Profiler.hpp"
+
+using namespace std;
+
+struct CellChange
+{
+    int i;
+    int j;
+    char c;
+};
+
+// Words of one board that is changed a few cells at a time. Every found word keeps the cells of
+// one of its paths. Update() drops the words whose path used a changed cell, searches only the
+// paths that go through a changed cell - they start within the longest word of a change - and
+// then looks for each dropped word that was not found again anywhere on the board, since it may
+// have another path that avoids the changes. The dictionary has to outlive the search.
+template <typename Topology = Orthogonal>
+class BasicIncrementalSearch
+{
+public:
+    BasicIncrementalSearch(const Dictionary& dictionary, const vector<vector<char>>& board) :
+        m_tree(dictionary.Tree())
+    {
+        WORDSEARCH_PROFILE_SCOPE("incremental_build");
+        CheckBoard(board);
+        m_n = (int)board[0].size();
+        m_grid.Set(board);
+        const int cells = m_grid.size();
+
+        // Children always have larger indices than their parent.
+        m_max_length.assign(m_tree.nodes_num, 0);
+        m_missing.assign(m_tree.nodes_num, 0);
+        m_parent.assign(m_tree.nodes_num, 0);
+        for (size_t i = m_tree.nodes_num; i-- > 1;)
+        {
+            const Node& node{ m_tree.nodes[i] };
+            uint16_t length = node.mask > 0 ? node.length : 0;
+            m_missing[i] = node.mask == 3 ? 2 : node.mask > 0;
+            for (int k = 0; k < node.children_num; ++k)
+            {
+                const uint32_t child = m_tree.child_pool[node.children + k];
+                length = max(length, m_max_length[child]);
+                m_missing[i] += m_missing[child];
+                m_parent[child] = (uint32_t)i;
+            }
+            m_max_length[i] = length;
+        }
+        for (uint32_t root : m_tree.Roots)
+        {
+            m_longest = max<int>(m_longest, root ? m_max_length[root] : 0);
+        }
+
+        m_entry_of.assign(size_t(m_tree.nodes_num) * 2, 0);
+        m_removed_stamp.assign(size_t(m_tree.nodes_num) * 2, 0);
+        m_cell_entries.resize(cells);
+        m_changed.assign(cells, 0);
+        m_distance.assign(cells, Far);
+
+        m_everywhere = true;
+        for (int cell = 0; cell < cells; ++cell)
+        {
+            Search(cell);
+        }
+        m_everywhere = false;
+    }
+
+    // Applies the changes and updates the words. added and removed, if given, receive the words
+    // that appeared and disappeared. Throws, before changing anything, if a cell is outside the
+    // board or a letter is not a symbol.
+    void Update(const vector<CellChange>& changes, vector<string>* added = nullptr, vector<string>* removed = nullptr)
+    {
+        WORDSEARCH_PROFILE_SCOPE("incremental_update");
+        const int m = m_grid.size() / m_n;
+        for (const CellChange& change : changes)
+        {
+            if (change.i < 0 || change.i >= m || change.j < 0 || change.j >= m_n)
+            {
+                throw runtime_error("changed cell outside the board");
+            }
+            if (!IsSymbol(change.c))
+            {
+                throw runtime_error("board letter outside the alphabet");
+            }
+        }
+        ++m_generation;
+        m_added = added;
+        m_removed.clear();
+        for (const CellChange& change : changes)
+        {
+            const int cell = change.i * m_n + change.j;
+            m_grid.letters[cell] = change.c;
+            m_grid.marks[cell] = change.c;
+            if (!m_changed[cell])
+            {
+                m_changed[cell] = 1;
+                m_changed_cells.push_back(cell);
+            }
+        }
+
+        for (int cell : m_changed_cells)
+        {
+            Invalidate(cell);
+        }
+
+        // Paths through a changed cell start at most m_longest - 1 steps away from it.
+        for (int cell : m_changed_cells)
+        {
+            m_distance[cell] = 0;
+        }
+        m_region = m_changed_cells;
+        for (size_t k = 0; k < m_region.size(); ++k)
+        {
+            const int cell = m_region[k];
+            if (m_distance[cell] + 1 >= m_longest)
+            {
+                continue;
+            }
+            for (int neighbor : m_grid.neighbors[cell])
+            {
+                if (neighbor >= 0 && m_distance[neighbor] == Far)
+                {
+                    m_distance[neighbor] = m_distance[cell] + 1;
+                    m_region.push_back(neighbor);
+                }
+            }
+        }
+        {
+            WORDSEARCH_PROFILE_SCOPE("incremental_region");
+            for (int cell : m_region)
+            {
+                Search(cell);
+            }
+        }
+
+        WORDSEARCH_PROFILE_SCOPE("incremental_recheck");
+        for (uint32_t key : m_removed)
+        {
+            if (m_entry_of[key])
+            {
+                continue;
+            }
+            if (!FindAnywhere(key) && removed)
+            {
+                removed->push_back(Word(key));
+            }
+        }
+
+        for (int cell : m_region)
+        {
+            m_distance[cell] = Far;
+        }
+        for (int cell : m_changed_cells)
+        {
+            m_changed[cell] = 0;
+        }
+        m_changed_cells.clear();
+        if (m_dead_entries > 4096 && m_dead_entries > m_entries.size() / 2)
+        {
+            Compact();
+        }
+    }
+
+    void Words(vector<string>& out) const
+    {
+        for (const Entry& entry : m_entries)
+        {
+            if (entry.alive)
+            {
+                out.push_back(Word(entry.key));
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return m_entries.size() - m_dead_entries;
+    }
+
+    vector<vector<char>> Board() const
+    {
+        vector<vector<char>> board(m_grid.size() / m_n, vector<char>(m_n));
+        for (int cell = 0; cell < m_grid.size(); ++cell)
+        {
+            board[cell / m_n][cell % m_n] = m_grid.letter(cell);
+        }
+        return board;
+    }
+
+private:
+    static constexpr uint16_t Far = UINT16_MAX;
+
+    // key is node index * 2 + 1 for the reversed word of the node.
+    struct Entry
+    {
+        uint32_t key;
+        uint32_t path; // offset in m_paths
+        uint16_t length;
+        bool alive;
+    };
+
+    TrieView m_tree;
+    BasicCellGrid<Topology> m_grid;
+    int m_n{ 0 };
+    int m_longest{ 0 };
+    vector<uint16_t> m_max_length; // longest word below the node
+    vector<uint32_t> m_missing;    // words below the node that are not on the board
+    vector<uint32_t> m_parent;
+
+    vector<Entry> m_entries;
+    vector<int> m_paths;
+    size_t m_dead_entries{ 0 };
+    vector<uint32_t> m_entry_of;               // key -> entry + 1, 0 if the word is not on the board
+    vector<vector<uint32_t>> m_cell_entries;   // entries whose path uses the cell, dead ones included
+
+    uint32_t m_generation{ 0 };
+    vector<uint32_t> m_removed_stamp; // generation in which the key was dropped
+    vector<uint32_t> m_removed;
+    vector<string>* m_added{ nullptr };
+    vector<uint8_t> m_changed;
+    vector<int> m_changed_cells;
+    vector<uint16_t> m_distance; // steps to the nearest changed cell, Far outside the region
+    vector<int> m_region;
+    bool m_everywhere{ false };
+    int m_touched{ 0 }; // changed cells on the current path
+    vector<int> m_path;
+
+    string Word(uint32_t key) const
+    {
+        const string_view pattern{ m_tree.pattern(m_tree.nodes[key >> 1]) };
+        string word{ pattern };
+        if (key & 1)
+        {
+            reverse(word.begin(), word.end());
+        }
+        return word;
+    }
+
+    void Invalidate(int cell)
+    {
+        for (uint32_t e : m_cell_entries[cell])
+        {
+            Entry& entry{ m_entries[e] };
+            if (!entry.alive)
+            {
+                continue;
+            }
+            entry.alive = false;
+            ++m_dead_entries;
+            m_entry_of[entry.key] = 0;
+            CountMissing(entry.key >> 1, 1);
+            m_removed_stamp[entry.key] = m_generation;
+            m_removed.push_back(entry.key);
+        }
+        m_cell_entries[cell].clear();
+    }
+
+    void CountMissing(uint32_t node_idx, int delta)
+    {
+        for (; node_idx; node_idx = m_parent[node_idx])
+        {
+            m_missing[node_idx] += delta;
+        }
+    }
+
+    void AddEntry(uint32_t key)
+    {
+        const uint32_t e = (uint32_t)m_entries.size();
+        m_entries.push_back({ key, (uint32_t)m_paths.size(), (uint16_t)m_path.size(), true });
+        m_paths.insert(m_paths.end(), m_path.begin(), m_path.end());
+        m_entry_of[key] = e + 1;
+        CountMissing(key >> 1, -1);
+        for (int cell : m_path)
+        {
+            m_cell_entries[cell].push_back(e);
+        }
+    }
+
+    // Drops dead entries once they are the majority.
+    void Compact()
+    {
+        vector<Entry> entries;
+        vector<int> paths;
+        entries.reserve(size());
+        for (auto& list : m_cell_entries)
+        {
+            list.clear();
+        }
+        for (const Entry& entry : m_entries)
+        {
+            if (!entry.alive)
+            {
+                continue;
+            }
+            const uint32_t e = (uint32_t)entries.size();
+            entries.push_back({ entry.key, (uint32_t)paths.size(), entry.length, true });
+            for (int k = 0; k < entry.length; ++k)
+            {
+                const int cell = m_paths[entry.path + k];
+                paths.push_back(cell);
+                m_cell_entries[cell].push_back(e);
+            }
+            m_entry_of[entry.key] = e + 1;
+        }
+        m_entries = move(entries);
+        m_paths = move(paths);
+        m_dead_entries = 0;
+    }
+
+    void Found(const Node& node)
+    {
+        const uint32_t node_idx = m_tree.index(node);
+        for (uint32_t key : { node_idx * 2, node_idx * 2 + 1 })
+        {
+            const bool present = (key & 1) ? node.mask >= 2 : (node.mask == 1 || node.mask == 3);
+            if (!present || m_entry_of[key])
+            {
+                continue;
+            }
+            AddEntry(key);
+            WORDSEARCH_COUNT_WORD(m_path.size());
+            if (m_added && !m_everywhere && m_removed_stamp[key] != m_generation)
+            {
+                m_added->push_back(Word(key));
+            }
+        }
+    }
+
+    // Can a path that has `length` cells, ends on cell and is inside node still reach a changed
+    // cell before its longest word ends?
+    bool Reachable(int cell, uint32_t node_idx, int length) const
+    {
+        return m_everywhere || m_touched || m_distance[cell] <= m_max_length[node_idx] - length;
+    }
+
+    void Push(int cell)
+    {
+        m_grid.Visit(cell);
+        m_path.push_back(cell);
+        m_touched += m_changed[cell];
+    }
+
+    void Pop()
+    {
+        const int cell = m_path.back();
+        m_touched -= m_changed[cell];
+        m_path.pop_back();
+        m_grid.Unvisit(cell);
+    }
+
+    void Search(int start)
+    {
+        const uint32_t root = m_tree.Roots[Symbol(m_grid.letter(start))];
+        if (!root || !m_missing[root] || !Reachable(start, root, 1))
+        {
+            return;
+        }
+        Push(start);
+        search_impl(m_tree.nodes[root], m_tree.pattern(m_tree.nodes[root]), 1);
+        Pop();
+    }
+
+    void search_impl(const Node& node, const string_view& node_pattern, const int idx)
+    {
+        if (idx == (int)node_pattern.size())
+        {
+            WORDSEARCH_COUNT(NodesVisited);
+            if (node.mask > 0 && (m_everywhere || m_touched))
+            {
+                Found(node);
+            }
+            // Led by the neighbours rather than the children, at most Degree probes per node.
+            // Subtrees whose words are all on the board already have nothing to add.
+            const uint32_t node_idx = m_tree.index(node);
+            for (int neighbor : m_grid.neighbors[m_path.back()])
+            {
+                if (!m_missing[node_idx])
+                {
+                    return;
+                }
+                if (neighbor < 0 || m_grid.marks[neighbor] == '$')
+                {
+                    continue;
+                }
+                const int c = Symbol(m_grid.letters[neighbor]);
+                if (!(node.children_mask & (uint64_t(1) << c)))
+                {
+                    continue;
+                }
+                const uint32_t child_idx = m_tree.child_pool[node.children + node.child_slot(c)];
+                if (m_missing[child_idx] && Reachable(neighbor, child_idx, idx + 1))
+                {
+                    const Node& child{ m_tree.nodes[child_idx] };
+                    Push(neighbor);
+                    search_impl(child, m_tree.pattern(child), idx + 1);
+                    Pop();
+                }
+            }
+            return;
+        }
+
+        WORDSEARCH_COUNT(NeighborProbes);
+        const uint32_t node_idx = m_tree.index(node);
+        m_grid.ForEachNeighbor(m_path.back(), node_pattern[idx], [&](int neighbor)
+        {
+            if (Reachable(neighbor, node_idx, idx + 1))
+            {
+                Push(neighbor);
+                search_impl(node, node_pattern, idx + 1);
+                Pop();
+            }
+            return m_missing[node_idx] != 0;
+        });
+    }
+
+    // Looks for a path of the word anywhere on the board and adds it.
+    bool FindAnywhere(uint32_t key)
+    {
+        const string_view pattern{ m_tree.pattern(m_tree.nodes[key >> 1]) };
+        for (int cell = 0; cell < m_grid.size(); ++cell)
+        {
+            if (m_grid.letter(cell) != pattern[0])
+            {
+                continue;
+            }
+            Push(cell);
+            const bool found{ Match(key, pattern, 1) };
+            Pop();
+            if (found)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Match(uint32_t key, const string_view& pattern, int idx)
+    {
+        if (idx == (int)pattern.size())
+        {
+            AddEntry(key);
+            return true;
+        }
+        bool found{ false };
+        m_grid.ForEachNeighbor(m_path.back(), pattern[idx], [&](int neighbor)
+        {
+            Push(neighbor);
+            found = Match(key, pattern, idx + 1);
+            Pop();
+            return !found;
+        });
+        return found;
+    }
+};
+
+using IncrementalSearch = BasicIncrementalSearch<Orthogonal>;
@@ -0,0 +1,212 @@
+// Load generator for the search server (SearchService.hpp):
+//
+//   g++ -std=c++17 -O2 -pthread LoadGenerator.cpp -o wordsearch_load    (or CMakeLists.txt)
+//   wordsearch serve --index words.idx --socket /tmp/wordsearch.sock &
+//   wordsearch_load --socket /tmp/wordsearch.sock [--connections N] [--depth N] [--requests N]
+//                   [--rows N] [--columns N] [--english] [--seed N]
+//
+// Every connection runs on its own thread and keeps depth queries in flight, sending the next one
+// as soon as an answer comes back. Boards are random, seeded per connection. Prints one JSON line
+// with the latencies seen by the clients and the throughput, then the server's own stats line.
+// Linux only.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SearchService.hpp"
+#include "Workloads.hpp"
+
+using namespace std;
+
+struct LoadOptions
+{
+    string socket_path;
+    int connections{ 4 };
+    int depth{ 4 };            // queries in flight per connection
+    int requests{ 20000 };     // in total
+    int rows{ 10 };
+    int columns{ 10 };
+    bool english{ false };
+    unsigned seed{ 1 };
+};
+
+struct ConnectionResult
+{
+    vector<double> latencies_us;
+    uint64_t words{ 0 };
+    uint64_t errors{ 0 };
+    string failure; // why the connection stopped early
+};
+
+void RunConnection(const LoadOptions& options, int index, int requests, ConnectionResult& result)
+{
+    using Clock = chrono::steady_clock;
+
+    SearchClient client{ options.socket_path };
+    const LetterDistribution letters{ options.english ? LetterDistribution::English() : LetterDistribution::Uniform() };
+    vector<Clock::time_point> sent(requests);
+    result.latencies_us.reserve(requests);
+
+    int next{ 0 };
+    auto send = [&]
+    {
+        const vector<vector<char>> board{ RandomBoard(options.rows, options.columns, options.seed * 1000003u + index * 7919u + next, letters) };
+        sent[next] = Clock::now();
+        client.SendQuery(uint32_t(next), board);
+        ++next;
+    };
+    while (next < requests && next < options.depth)
+    {
+        send();
+    }
+
+    ServiceMessage type;
+    uint32_t tag;
+    string payload;
+    for (int done = 0; done < requests; ++done)
+    {
+        client.Receive(type, tag, payload);
+        result.latencies_us.push_back(chrono::duration<double, micro>(Clock::now() - sent[tag]).count());
+        if (type == ServiceMessage::Words)
+        {
+            result.words += ReadU32(payload.data());
+        }
+        else
+        {
+            ++result.errors;
+        }
+        if (next < requests)
+        {
+            send();
+        }
+    }
+}
+
+double Percentile(const vector<double>& sorted, double q)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    return sorted[min(sorted.size() - 1, size_t(q * (sorted.size() - 1) + 0.5))];
+}
+
+int main(int argc, char** argv)
+{
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg{ argv[i] };
+        const bool has_value{ i + 1 < argc };
+        if (arg == "--socket" && has_value)
+        {
+            options.socket_path = argv[++i];
+        }
+        else if (arg == "--connections" && has_value)
+        {
+            options.connections = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--depth" && has_value)
+        {
+            options.depth = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--requests" && has_value)
+        {
+            options.requests = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--rows" && has_value)
+        {
+            options.rows = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--columns" && has_value)
+        {
+            options.columns = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--english")
+        {
+            options.english = true;
+        }
+        else if (arg == "--seed" && has_value)
+        {
+            options.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            cerr << "unknown argument " << arg << endl;
+            return 1;
+        }
+    }
+    if (options.socket_path.empty())
+    {
+        cerr << "usage: wordsearch_load --socket <path> [--connections N] [--depth N] [--requests N]"
+            " [--rows N] [--columns N] [--english] [--seed N]" << endl;
+        return 1;
+    }
+
+    try
+    {
+        vector<ConnectionResult> results(options.connections);
+        vector<thread> threads;
+        const auto start = chrono::steady_clock::now();
+        for (int c = 0; c < options.connections; ++c)
+        {
+            const int requests = options.requests / options.connections + (c < options.requests % options.connections);
+            threads.emplace_back([&, c, requests]
+            {
+                try
+                {
+                    RunConnection(options, c, requests, results[c]);
+                }
+                catch (const exception& e)
+                {
+                    results[c].failure = e.what();
+                }
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        vector<double> latencies;
+        uint64_t words{ 0 };
+        uint64_t errors{ 0 };
+        for (auto& result : results)
+        {
+            latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+            words += result.words;
+            errors += result.errors;
+            if (!result.failure.empty())
+            {
+                throw runtime_error(result.failure);
+            }
+        }
+        sort(latencies.begin(), latencies.end());
+        cout << "{\"connections\":" << options.connections << ",\"depth\":" << options.depth
+            << ",\"board\":\"" << options.rows << "x" << options.columns << "\""
+            << ",\"queries\":" << latencies.size() << ",\"errors\":" << errors << ",\"words\":" << words
+            << ",\"seconds\":" << seconds << ",\"queries_per_s\":" << latencies.size() / max(seconds, 1e-9)
+            << ",\"latency_us\":{\"p50\":" << Percentile(latencies, 0.5) << ",\"p90\":" << Percentile(latencies, 0.9)
+            << ",\"p99\":" << Percentile(latencies, 0.99) << ",\"p999\":" << Percentile(latencies, 0.999)
+            << ",\"max\":" << (latencies.empty() ? 0 : latencies.back()) << "}}" << endl;
+
+        SearchClient client{ options.socket_path };
+        client.SendStats(0);
+        ServiceMessage type;
+        uint32_t tag;
+        string payload;
+        client.Receive(type, tag, payload);
+        cout << payload << endl;
+    }
+    catch (const exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Alphabet.hpp"
+#include "Topology.hpp"
+
+using namespace std;
+
+// Which end of a word the tree stores first. The search starts a word at every cell of its first
+// stored letter and extends the paths one letter at a time, so the cheaper end to start from is
+// the one whose prefixes have fewer matching paths on the board.
+//
+// The estimate costs about a third of the tree build, while on random boards it saves 15-30% of a
+// search that is much shorter than the build. Auto only uses it when paths multiply along a prefix
+// (OrientationCost::Fanout() >= 1), where the orientation decides between microseconds and
+// seconds, and on boards of OrientationCost::HugeBoardCells and more, where the search dominates.
+enum class OrientationPolicy
+{
+    Runs,      // the end with the shorter run of one letter, needs no board
+    BoardCost, // the end with fewer estimated probes on the board, runs on ties
+    Auto,      // BoardCost on skewed or huge boards, Runs elsewhere
+};
+
+// A word is stored backwards when it ends with a longer run of one letter than it starts with.
+inline bool RunsReversed(const string& word)
+{
+    int left = word.find_first_not_of(word[0]);
+    int right = word.size() - word.find_last_not_of(word[word.size() - 1]);
+    return left > right;
+}
+
+// Estimated DFS probes of a word from either end. A cell of letter x has on average step(x, y)
+// neighbours of letter y, so a prefix c0..ck is expected on count(c0) * step(c0, c1) * ... *
+// step(ck-1, ck) paths, and every one of them probes the neighbours for the next letter.
+//
+// A trie edge is probed once for all the words below it, so the probes of the first SharedDepth
+// letters are divided between the words that start the same way; deeper down the sharing is
+// assumed to keep narrowing at the rate of the last counted letter. Sharing makes the choices
+// depend on each other: every word first picks its end on its own, the shares are counted with
+// those picks and then every word turns around if that is cheaper with the others staying put.
+// Visited cells are ignored.
+class OrientationCost
+{
+public:
+    static constexpr double HugeBoardCells = 8192;
+
+    template <typename Topology = Orthogonal>
+    static OrientationCost FromBoard(const vector<vector<char>>& board)
+    {
+        OrientationCost cost;
+        const int m = (int)board.size();
+        for (int i = 0; i < m; ++i)
+        {
+            const int n = (int)board[i].size();
+            for (int j = 0; j < n; ++j)
+            {
+                const int c = Symbol(board[i][j]);
+                ++cost.m_count[c];
+                ++cost.m_cells;
+                for (int slot = 0; slot < Topology::Degree; ++slot)
+                {
+                    int ni, nj;
+                    if (Topology::Neighbor(slot, i, j, m, n, ni, nj) && (ni != i || nj != j))
+                    {
+                        ++cost.m_step[c * MaxSymbols + Symbol(board[ni][nj])];
+                    }
+                }
+            }
+        }
+
+        // Prefix keys only need the letters of the board, the others share one digit.
+        int letters{ 0 };
+        for (int c = 0; c < MaxSymbols; ++c)
+        {
+            if (cost.m_count[c])
+            {
+                cost.m_digit[c] = (uint8_t)++letters;
+                for (int next = 0; next < MaxSymbols; ++next)
+                {
+                    cost.m_step[c * MaxSymbols + next] /= cost.m_count[c];
+                }
+            }
+        }
+        for (int c = 0; c < MaxSymbols; ++c)
+        {
+            if (!cost.m_count[c])
+            {
+                cost.m_digit[c] = (uint8_t)(letters + 1);
+            }
+        }
+        cost.m_base = letters + 2;
+        return cost;
+    }
+
+    // Expected neighbours of a cell that continue a path spelling letters drawn from the board.
+    // At 1 and above the paths of a prefix multiply with its length.
+    double Fanout() const
+    {
+        double fanout{ 0 };
+        for (int c = 0; c < MaxSymbols; ++c)
+        {
+            for (int next = 0; next < MaxSymbols; ++next)
+            {
+                fanout += m_count[c] * m_step[c * MaxSymbols + next] * m_count[next];
+            }
+        }
+        return m_cells ? fanout / (m_cells * m_cells) : 0;
+    }
+
+    double Cells() const
+    {
+        return m_cells;
+    }
+
+    // Orientation of every word, 1 to store it backwards. feasible as in FeasibleWords, or nullptr
+    // for all of them; the other words are left at 0.
+    vector<uint8_t> Orient(const vector<string>& words, const uint8_t* feasible)
+    {
+        vector<uint8_t> reversed(words.size(), 0);
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            if ((!feasible || feasible[i]) && !words[i].empty())
+            {
+                reversed[i] = Pick(words[i], false, false, RunsReversed(words[i]));
+            }
+        }
+
+        CountShares(words, feasible, reversed);
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            if ((!feasible || feasible[i]) && !words[i].empty())
+            {
+                reversed[i] = Pick(words[i], true, reversed[i], reversed[i]);
+            }
+        }
+        return reversed;
+    }
+
+    // Estimated probes of the word read forwards or backwards, on its own or, with the shares,
+    // together with the other words. counted: the word is among the shares that way round.
+    double Cost(string_view word, bool reversed, bool with_shares, bool counted) const
+    {
+        const int size = (int)word.size();
+        auto at = [&](int i) { return Symbol(word[reversed ? size - 1 - i : i]); };
+        const vector<uint32_t>& shared{ m_shared[reversed] };
+        auto share = [&](uint32_t key) { return with_shares ? double(shared[key] + !counted) : 1.0; };
+
+        int previous = at(0);
+        uint32_t key{ PrefixKey(0, previous) };
+        double paths = m_count[previous];
+        double prefix_share = share(key);
+        double cost = paths / prefix_share;
+        double narrowing{ 1 };
+        for (int i = 1; i < size && paths > 0; ++i)
+        {
+            const int c = at(i);
+            if (i < SharedDepth)
+            {
+                key = PrefixKey(key, c);
+                const double next_share = share(key);
+                narrowing = next_share / prefix_share;
+                prefix_share = next_share;
+            }
+            else
+            {
+                prefix_share = max(1.0, prefix_share * narrowing);
+            }
+            cost += paths / prefix_share;
+            paths *= m_step[previous * MaxSymbols + c];
+            previous = c;
+        }
+        return cost;
+    }
+
+private:
+    static constexpr int SharedDepth = 3;
+
+    double m_count[MaxSymbols] = {};             // cells of every symbol
+    double m_step[MaxSymbols * MaxSymbols] = {}; // [x * MaxSymbols + y]: neighbours of letter y per cell of letter x
+    double m_cells{ 0 };
+    uint8_t m_digit[MaxSymbols] = {};            // symbol -> digit in the prefix keys
+    uint32_t m_base{ 0 };
+    vector<uint32_t> m_shared[2];                // [reversed][PrefixKey]: words starting with the prefix
+
+    // Prefixes of up to SharedDepth symbols as base m_base numbers, 0 is the empty one.
+    uint32_t PrefixKey(uint32_t key, int c) const
+    {
+        return key * m_base + m_digit[c];
+    }
+
+    void CountShares(const vector<string>& words, const uint8_t* feasible, const vector<uint8_t>& reversed)
+    {
+        for (auto& shared : m_shared)
+        {
+            shared.assign(size_t(m_base) * m_base * m_base, 0);
+        }
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            const string& word{ words[i] };
+            if ((feasible && !feasible[i]) || word.empty())
+            {
+                continue;
+            }
+            const int depth = min<int>(SharedDepth, (int)word.size());
+            uint32_t key{ 0 };
+            for (int k = 0; k < depth; ++k)
+            {
+                key = PrefixKey(key, Symbol(word[reversed[i] ? word.size() - 1 - k : k]));
+                ++m_shared[reversed[i]][key];
+            }
+        }
+    }
+
+    // The cheaper end, tie on about equal costs. With the shares the word is counted as stored
+    // backwards if counted_reversed.
+    bool Pick(string_view word, bool with_shares, bool counted_reversed, bool tie) const
+    {
+        static constexpr double Tolerance = 1e-9;
+
+        const double forward = Cost(word, false, with_shares, with_shares && !counted_reversed);
+        const double backward = Cost(word, true, with_shares, with_shares && counted_reversed);
+        if (backward < forward * (1 - Tolerance))
+        {
+            return true;
+        }
+        if (forward < backward * (1 - Tolerance))
+        {
+            return false;
+        }
+        return tie;
+    }
+};
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SuffixTree.hpp"
+
+using namespace std;
+
+// Owner pushes/pops at the back, thieves take from the front.
+template <typename T>
+class WorkStealingQueue
+{
+public:
+    void push(const T& item)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_items.push_back(item);
+    }
+
+    bool pop(T& item)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_items.empty())
+        {
+            return false;
+        }
+        item = m_items.back();
+        m_items.pop_back();
+        return true;
+    }
+
+    bool steal(T& item)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_items.empty())
+        {
+            return false;
+        }
+        item = m_items.front();
+        m_items.pop_front();
+        return true;
+    }
+
+private:
+    mutex m_mutex;
+    deque<T> m_items;
+};
+
+// Searches a SuffixTree from several threads at once. Unlike DFSWordFinder the tree is not
+// pruned in place: found words and fully found subtrees are tracked with atomic flags kept per
+// node index, so each word is reported exactly once. The set of found words is the same
+// as for DFSWordFinder, their order is not.
+struct ParallelWordFinder
+{
+    enum : uint8_t { Found = 1, Exhausted = 2 };
+
+    struct Task
+    {
+        int cell;
+        int root;
+    };
+
+    struct Worker
+    {
+        ParallelWordFinder& finder;
+        vector<char> grid; // board copy, '$' marks visited cells
+        vector<int> path;
+        vector<string> words;
+
+        Worker(ParallelWordFinder& in_finder) :
+            finder(in_finder),
+            grid(in_finder.letters)
+        {
+        }
+
+        void run(const Node& root, int start)
+        {
+            path.clear();
+            path.push_back(start);
+            grid[start] = '$';
+            search_impl(root, 1);
+            grid[start] = finder.letters[start];
+        }
+
+        // Returns true once every word below node has been reported.
+        bool search_impl(const Node& node, const int idx)
+        {
+            const SuffixTree& tree{ *finder.tree };
+            atomic<uint8_t>& state{ finder.states[&node - tree.nodes.data()] };
+            if (state.load(memory_order_acquire) & Exhausted)
+            {
+                return true;
+            }
+            const string_view node_pattern{ tree.pattern(node) };
+            if (idx == (int)node_pattern.size())
+            {
+                WORDSEARCH_COUNT(NodesVisited);
+                report(node, state);
+                bool exhausted{ true };
+                for (int i = 0; i < node.children_num; ++i)
+                {
+                    if (!search_impl(tree.nodes[tree.child_pool[node.children + i]], idx))
+                    {
+                        exhausted = false;
+                    }
+                }
+                if (exhausted)
+                {
+                    state.fetch_or(Exhausted, memory_order_release);
+                }
+                return exhausted;
+            }
+
+            WORDSEARCH_COUNT(NeighborProbes);
+            const char p = node_pattern[idx];
+            for (int neighbor : finder.neighbors[path.back()])
+            {
+                if (neighbor < 0 || grid[neighbor] != p)
+                {
+                    continue;
+                }
+                grid[neighbor] = '$';
+                path.push_back(neighbor);
+                bool exhausted = search_impl(node, idx + 1);
+                path.pop_back();
+                grid[neighbor] = p;
+                WORDSEARCH_COUNT(Backtracks);
+                if (exhausted)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void report(const Node& node, atomic<uint8_t>& state)
+        {
+            if (node.mask <= 0 || (state.fetch_or(Found, memory_order_acq_rel) & Found))
+            {
+                return;
+            }
+            const string_view node_pattern{ finder.tree->pattern(node) };
+            if (node.mask == 1 || node.mask == 3)
+            {
+                words.push_back(string{ node_pattern });
+                WORDSEARCH_COUNT_WORD(node_pattern.size());
+            }
+            if (node.mask >= 2)
+            {
+                words.push_back(string{ node_pattern });
+                reverse(words.back().begin(), words.back().end());
+                WORDSEARCH_COUNT_WORD(node_pattern.size());
+            }
+        }
+    };
+
+    vector<string>& out_words;
+    const SuffixTree* tree{ nullptr };
+    unique_ptr<atomic<uint8_t>[]> states;
+    vector<char> letters;
+    vector<array<int, 4>> neighbors;
+    int threads_num;
+
+    ParallelWordFinder(const vector<vector<char>>& board, vector<string>& words, int in_threads_num = 0) :
+        out_words(words),
+        threads_num(in_threads_num)
+    {
+        CheckBoard(board);
+        if (threads_num <= 0)
+        {
+            threads_num = max(1u, thread::hardware_concurrency());
+        }
+        const int m = (int)board.size();
+        const int n = (int)board[0].size();
+        letters.resize(m * n);
+        neighbors.resize(m * n);
+        for (int i = 0; i < m; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                const int idx = i * n + j;
+                letters[idx] = board[i][j];
+                neighbors[idx] = {
+                    j > 0 ? idx - 1 : -1,
+                    j < n - 1 ? idx + 1 : -1,
+                    i > 0 ? idx - n : -1,
+                    i < m - 1 ? idx + n : -1 };
+            }
+        }
+    }
+
+    void FindWords(const SuffixTree& Tree)
+    {
+        WORDSEARCH_PROFILE_SCOPE("parallel_search");
+        tree = &Tree;
+        states.reset(new atomic<uint8_t>[Tree.nodes.size()]);
+        for (size_t i = 0; i < Tree.nodes.size(); ++i)
+        {
+            states[i].store(0, memory_order_relaxed);
+        }
+
+        vector<Task> tasks;
+        for (int i = 0; i < (int)letters.size(); ++i)
+        {
+            const int root = Symbol(letters[i]);
+            if (Tree.Roots[root])
+            {
+                tasks.push_back(Task{ i, root });
+            }
+        }
+        // Contiguous blocks of equal size keep neighbouring start cells on one worker.
+        vector<WorkStealingQueue<Task>> queues(threads_num);
+        for (size_t k = 0; k < tasks.size(); ++k)
+        {
+            queues[k * threads_num / tasks.size()].push(tasks[k]);
+        }
+
+        vector<Worker> workers;
+        workers.reserve(threads_num);
+        for (int t = 0; t < threads_num; ++t)
+        {
+            workers.emplace_back(*this);
+        }
+
+        auto work = [&](int t)
+        {
+            Task task;
+            while (true)
+            {
+                bool found = queues[t].pop(task);
+                for (int k = 1; !found && k < threads_num; ++k)
+                {
+                    found = queues[(t + k) % threads_num].steal(task);
+                }
+                if (!found)
+                {
+                    return;
+                }
+                workers[t].run(Tree.nodes[Tree.Roots[task.root]], task.cell);
+            }
+        };
+
+        vector<thread> threads;
+        for (int t = 1; t < threads_num; ++t)
+        {
+            threads.emplace_back(work, t);
+        }
+        work(0);
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        for (auto& worker : workers)
+        {
+            out_words.insert(out_words.end(), worker.words.begin(), worker.words.end());
+        }
+    }
+};
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// WORDSEARCH_PROFILE selects what is compiled in:
+//   0 - nothing, every macro below is empty
+//   1 - scope timers (default)
+//   2 - scope timers and the search hot-path counters
+#ifndef WORDSEARCH_PROFILE
+#define WORDSEARCH_PROFILE 1
+#endif
+
+enum class ProfileCounter : int
+{
+    NodesVisited,   // trie nodes whose whole edge was matched on the board
+    NeighborProbes, // neighbour expansions tried
+    Backtracks,     // cells taken back off the path
+    WordsFound,
+    Count
+};
+
+inline const char* ProfileCounterName(ProfileCounter counter)
+{
+    static const char* names[] = { "nodes_visited", "neighbor_probes", "backtracks", "words_found" };
+    return names[(int)counter];
+}
+
+// Timers are registered once per name and nest: a timer opened inside another one is a separate
+// entry below it. Every thread accumulates into its own data, nothing is shared on the hot path;
+// the reports merge all threads and must only run once the measured threads are done.
+class Profiler
+{
+    struct ThreadData;
+
+public:
+    static constexpr int MaxDepth = 64; // longer words are counted in the last bucket
+
+    static int Register(const char* name)
+    {
+        Registry& registry{ GetRegistry() };
+        lock_guard<mutex> guard(registry.lock);
+        for (size_t i = 0; i < registry.names.size(); ++i)
+        {
+            if (strcmp(registry.names[i], name) == 0)
+            {
+                return (int)i;
+            }
+        }
+        registry.names.push_back(name);
+        return (int)registry.names.size() - 1;
+    }
+
+    class Scope
+    {
+    public:
+        Scope(int timer) : m_data(Local()), m_start(Now())
+        {
+            m_parent = m_data.current;
+            m_data.current = m_data.Child(m_parent, timer);
+        }
+
+        ~Scope()
+        {
+            const int64_t end = Now();
+            ThreadData::Node& node{ m_data.nodes[m_data.current] };
+            node.ns += end - m_start;
+            ++node.calls;
+            if (s_trace.load(memory_order_relaxed))
+            {
+                m_data.events.push_back({ node.timer, m_start, end - m_start });
+            }
+            m_data.current = m_parent;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ThreadData& m_data;
+        int64_t m_start;
+        int m_parent;
+    };
+
+    static void Count(ProfileCounter counter, uint64_t n = 1)
+    {
+        Local().counters[(int)counter] += n;
+    }
+
+    static void CountWord(size_t depth)
+    {
+        ThreadData& data{ Local() };
+        ++data.counters[(int)ProfileCounter::WordsFound];
+        ++data.words_per_depth[min<size_t>(depth, MaxDepth)];
+    }
+
+    // Records every timed scope as a trace event from now on, see WriteChromeTrace.
+    static void EnableTrace(bool enable)
+    {
+        s_trace.store(enable, memory_order_relaxed);
+    }
+
+    // {"timers": [{"name", "calls", "total_ms", "children": [...]}], "counters": {...},
+    //  "words_per_depth": {"<length>": count}}
+    static void WriteJson(ostream& out)
+    {
+        const Summary summary{ Merge() };
+        out << "{\"timers\":";
+        WriteTimers(out, summary, -1);
+        out << ",\"counters\":{";
+        for (int c = 0; c < (int)ProfileCounter::Count; ++c)
+        {
+            out << (c ? "," : "") << '"' << ProfileCounterName((ProfileCounter)c) << "\":" << summary.counters[c];
+        }
+        out << "},\"words_per_depth\":{";
+        bool first{ true };
+        for (int d = 0; d <= MaxDepth; ++d)
+        {
+            if (summary.words_per_depth[d])
+            {
+                out << (first ? "" : ",") << '"' << d << "\":" << summary.words_per_depth[d];
+                first = false;
+            }
+        }
+        out << "}}" << endl;
+    }
+
+    // Chrome trace event format, load it in chrome://tracing or Perfetto. Needs EnableTrace(true)
+    // before the measured code runs; the counters are added as one sample at the end.
+    static void WriteChromeTrace(ostream& out)
+    {
+        Registry& registry{ GetRegistry() };
+        lock_guard<mutex> guard(registry.lock);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first{ true };
+        int64_t last{ 0 };
+        uint64_t counters[(int)ProfileCounter::Count] = {};
+        for (auto& data : registry.threads)
+        {
+            for (auto& event : data->events)
+            {
+                out << (first ? "" : ",\n") << "{\"name\":\"" << registry.names[event.timer]
+                    << "\",\"cat\":\"wordsearch\",\"ph\":\"X\",\"pid\":1,\"tid\":" << data->tid
+                    << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0 << "}";
+                first = false;
+                last = max(last, event.start + event.duration);
+            }
+            for (int c = 0; c < (int)ProfileCounter::Count; ++c)
+            {
+                counters[c] += data->counters[c];
+            }
+        }
+        for (int c = 0; c < (int)ProfileCounter::Count; ++c)
+        {
+            out << (first ? "" : ",\n") << "{\"name\":\"" << ProfileCounterName((ProfileCounter)c)
+                << "\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << last / 1000.0 << ",\"args\":{\"value\":" << counters[c] << "}}";
+            first = false;
+        }
+        out << "]}" << endl;
+    }
+
+    // Indented timer tree and the non-zero counters.
+    static void PrintSummary(ostream& out)
+    {
+        const Summary summary{ Merge() };
+        PrintTimers(out, summary, -1, 0);
+        for (int c = 0; c < (int)ProfileCounter::Count; ++c)
+        {
+            if (summary.counters[c])
+            {
+                out << ProfileCounterName((ProfileCounter)c) << ": " << summary.counters[c] << endl;
+            }
+        }
+    }
+
+private:
+    struct ThreadData
+    {
+        struct Node
+        {
+            int timer;
+            int parent;
+            int64_t ns;
+            uint64_t calls;
+        };
+
+        struct Event
+        {
+            int timer;
+            int64_t start;
+            int64_t duration;
+        };
+
+        int tid{ 0 };
+        vector<Node> nodes;
+        int current{ -1 };
+        uint64_t counters[(int)ProfileCounter::Count] = {};
+        uint64_t words_per_depth[MaxDepth + 1] = {};
+        vector<Event> events;
+
+        int Child(int parent, int timer)
+        {
+            for (size_t i = 0; i < nodes.size(); ++i)
+            {
+                if (nodes[i].parent == parent && nodes[i].timer == timer)
+                {
+                    return (int)i;
+                }
+            }
+            nodes.push_back({ timer, parent, 0, 0 });
+            return (int)nodes.size() - 1;
+        }
+    };
+
+    struct Registry
+    {
+        mutex lock;
+        vector<const char*> names;
+        vector<unique_ptr<ThreadData>> threads; // kept after the thread exits so reports see it
+    };
+
+    struct Summary : ThreadData
+    {
+        vector<const char*> names;
+    };
+
+    inline static atomic<bool> s_trace{ false };
+
+    static Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    static int64_t Now()
+    {
+        static const auto epoch = chrono::steady_clock::now();
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+    }
+
+    static ThreadData& Local()
+    {
+        thread_local ThreadData* data{ nullptr };
+        if (!data)
+        {
+            Registry& registry{ GetRegistry() };
+            lock_guard<mutex> guard(registry.lock);
+            registry.threads.emplace_back(new ThreadData());
+            data = registry.threads.back().get();
+            data->tid = (int)registry.threads.size();
+        }
+        return *data;
+    }
+
+    static Summary Merge()
+    {
+        Registry& registry{ GetRegistry() };
+        lock_guard<mutex> guard(registry.lock);
+        Summary summary;
+        vector<int> mapping;
+        for (auto& data : registry.threads)
+        {
+            // Parents are always created before their children, so one pass maps every node.
+            mapping.assign(data->nodes.size(), -1);
+            for (size_t i = 0; i < data->nodes.size(); ++i)
+            {
+                const ThreadData::Node& node{ data->nodes[i] };
+                mapping[i] = summary.Child(node.parent < 0 ? -1 : mapping[node.parent], node.timer);
+                summary.nodes[mapping[i]].ns += node.ns;
+                summary.nodes[mapping[i]].calls += node.calls;
+            }
+            for (int c = 0; c < (int)ProfileCounter::Count; ++c)
+            {
+                summary.counters[c] += data->counters[c];
+            }
+            for (int d = 0; d <= MaxDepth; ++d)
+            {
+                summary.words_per_depth[d] += data->words_per_depth[d];
+            }
+        }
+        summary.names = registry.names;
+        return summary;
+    }
+
+    static void WriteTimers(ostream& out, const Summary& summary, int parent)
+    {
+        out << '[';
+        bool first{ true };
+        for (size_t i = 0; i < summary.nodes.size(); ++i)
+        {
+            const ThreadData::Node& node{ summary.nodes[i] };
+            if (node.parent != parent)
+            {
+                continue;
+            }
+            out << (first ? "" : ",") << "{\"name\":\"" << summary.names[node.timer] << "\",\"calls\":" << node.calls
+                << ",\"total_ms\":" << node.ns / 1e6 << ",\"children\":";
+            WriteTimers(out, summary, (int)i);
+            out << '}';
+            first = false;
+        }
+        out << ']';
+    }
+
+    static void PrintTimers(ostream& out, const Summary& summary, int parent, int indent)
+    {
+        for (size_t i = 0; i < summary.nodes.size(); ++i)
+        {
+            const ThreadData::Node& node{ summary.nodes[i] };
+            if (node.parent == parent)
+            {
+                out << string(indent * 2, ' ') << summary.names[node.timer] << " elapsed time: " << node.ns / 1000000
+                    << "ms (" << node.calls << " calls)" << endl;
+                PrintTimers(out, summary, (int)i, indent + 1);
+            }
+        }
+    }
+};
+
+#define WORDSEARCH_PROFILE_CONCAT2(a, b) a##b
+#define WORDSEARCH_PROFILE_CONCAT(a, b) WORDSEARCH_PROFILE_CONCAT2(a, b)
+
+#if WORDSEARCH_PROFILE >= 1
+// Times the rest of the enclosing block under name, a string literal.
+#define WORDSEARCH_PROFILE_SCOPE(name)                                                                     \
+    static const int WORDSEARCH_PROFILE_CONCAT(profile_timer_, __LINE__) = Profiler::Register(name);       \
+    Profiler::Scope WORDSEARCH_PROFILE_CONCAT(profile_scope_, __LINE__) { WORDSEARCH_PROFILE_CONCAT(profile_timer_, __LINE__) }
+#else
+#define WORDSEARCH_PROFILE_SCOPE(name) ((void)0)
+#endif
+
+#if WORDSEARCH_PROFILE >= 2
+#define WORDSEARCH_COUNT(counter) Profiler::Count(ProfileCounter::counter)
+#define WORDSEARCH_COUNT_WORD(depth) Profiler::CountWord(depth)
+#else
+#define WORDSEARCH_COUNT(counter) ((void)0)
+#define WORDSEARCH_COUNT_WORD(depth) ((void)0)
+#endif
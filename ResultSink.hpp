@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Profiler.hpp"
+
+using namespace std;
+
+// The search engines report every found word to a sink:
+//
+//   template <typename Cell>
+//   void operator()(uint32_t word_id, string_view stored, const Cell* path, int length);
+//
+// word_id is WordId(node index, reversed) and stays the same for a given tree or dictionary.
+// stored is the node pattern as it is kept in the tree, so a reversed word comes backwards. path
+// holds the board cells (i * n + j) under stored, in the same order, and is only valid during the
+// call. The engines do not allocate per word; whatever the sink keeps is up to the sink.
+
+inline uint32_t WordId(uint32_t node_idx, bool reversed)
+{
+    return node_idx * 2 + (reversed ? 1 : 0);
+}
+
+inline uint32_t WordNode(uint32_t word_id)
+{
+    return word_id >> 1;
+}
+
+inline bool WordReversed(uint32_t word_id)
+{
+    return word_id & 1;
+}
+
+// Reports the forward and/or the reversed word of a node, as its mask says.
+template <typename Sink, typename Cell>
+inline void ReportWords(Sink& sink, uint32_t node_idx, int mask, string_view stored, const Cell* path, int length)
+{
+    if (mask == 1 || mask == 3)
+    {
+        sink(WordId(node_idx, false), stored, path, length);
+        WORDSEARCH_COUNT_WORD(stored.size());
+    }
+    if (mask >= 2)
+    {
+        sink(WordId(node_idx, true), stored, path, length);
+        WORDSEARCH_COUNT_WORD(stored.size());
+    }
+}
+
+// One string per word, the original output of the engines.
+struct StringSink
+{
+    vector<string>* out;
+
+    StringSink(vector<string>& words) : out(&words)
+    {
+    }
+
+    template <typename Cell>
+    void operator()(uint32_t word_id, string_view stored, const Cell*, int)
+    {
+        out->emplace_back(stored);
+        if (WordReversed(word_id))
+        {
+            reverse(out->back().begin(), out->back().end());
+        }
+    }
+};
+
+// Word ids, words and paths in flat buffers. clear() keeps the capacity, so a reused arena stops
+// allocating once it has seen its largest result. Engines take it by reference:
+// BasicDFSWordFinder<15, 32, Orthogonal, ResultArena&>.
+class ResultArena
+{
+public:
+    ResultArena()
+    {
+        m_offsets.push_back(0);
+    }
+
+    void clear()
+    {
+        m_ids.clear();
+        m_offsets.resize(1);
+        m_text.clear();
+        m_cells.clear();
+    }
+
+    void reserve(size_t words, size_t letters)
+    {
+        m_ids.reserve(words);
+        m_offsets.reserve(words + 1);
+        m_text.reserve(letters);
+        m_cells.reserve(letters);
+    }
+
+    size_t size() const
+    {
+        return m_ids.size();
+    }
+
+    uint32_t id(size_t k) const
+    {
+        return m_ids[k];
+    }
+
+    string_view word(size_t k) const
+    {
+        return string_view{ m_text.data() + m_offsets[k], m_offsets[k + 1] - m_offsets[k] };
+    }
+
+    // Cells of word(k), letter by letter; path_length(k) == word(k).size().
+    const uint32_t* path(size_t k) const
+    {
+        return m_cells.data() + m_offsets[k];
+    }
+
+    int path_length(size_t k) const
+    {
+        return int(m_offsets[k + 1] - m_offsets[k]);
+    }
+
+    template <typename Cell>
+    void operator()(uint32_t word_id, string_view stored, const Cell* path, int length)
+    {
+        m_ids.push_back(word_id);
+        m_offsets.push_back(m_offsets.back() + length);
+        if (WordReversed(word_id))
+        {
+            m_text.append(stored.rbegin(), stored.rend());
+            m_cells.insert(m_cells.end(), make_reverse_iterator(path + length), make_reverse_iterator(path));
+        }
+        else
+        {
+            m_text.append(stored);
+            m_cells.insert(m_cells.end(), path, path + length);
+        }
+    }
+
+private:
+    vector<uint32_t> m_ids;
+    vector<uint32_t> m_offsets; // word k is [m_offsets[k], m_offsets[k + 1]) of m_text and m_cells
+    string m_text;
+    vector<uint32_t> m_cells;
+};
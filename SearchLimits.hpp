@@ -0,0 +1,142 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+// Early termination for one search: after max_results words, at the first word, or at a deadline.
+// The engines look at the clock once every DeadlineCheckInterval search steps, so a search runs past
+// its deadline by at most that many steps, a few microseconds.
+struct SearchLimits
+{
+    using Clock = chrono::steady_clock;
+
+    static constexpr uint32_t DeadlineCheckInterval = 256;
+
+    uint64_t max_results{ 0 }; // 0 - no limit
+    bool exists_only{ false }; // stop at the first word, max_results = 1
+    Clock::time_point deadline{ Clock::time_point::max() };
+
+    // Stops budget from now.
+    static SearchLimits Within(chrono::microseconds budget)
+    {
+        SearchLimits limits;
+        limits.deadline = Clock::now() + budget;
+        return limits;
+    }
+
+    uint64_t MaxResults() const
+    {
+        return exists_only ? 1 : max_results;
+    }
+};
+
+enum class SearchStop : uint8_t
+{
+    Completed,
+    MaxResults,
+    Deadline,
+};
+
+// What a search did. After an early stop the words reported so far are a partial result: every
+// word that starts in one of the cells_searched cells is in it, the rest may be missing. Words
+// stored reversed in the tree start at their last letter.
+struct SearchStatus
+{
+    SearchStop stop{ SearchStop::Completed };
+    uint64_t results{ 0 };
+    uint32_t cells_searched{ 0 };
+    uint32_t cells{ 0 };
+
+    bool partial() const
+    {
+        return stop != SearchStop::Completed;
+    }
+
+    // Share of the board's start cells that were searched to the end.
+    double coverage() const
+    {
+        return cells ? double(cells_searched) / cells : 1.0;
+    }
+};
+
+// The limits while an engine searches. Word counting happens once per word; only Step() is on the
+// hot path, and without a deadline it is a single predictable branch.
+class SearchBudget
+{
+public:
+    void Start(const SearchLimits& limits, uint32_t cells)
+    {
+        m_status = SearchStatus{};
+        m_status.cells = cells;
+        m_max_results = limits.MaxResults();
+        m_deadline = limits.deadline;
+        m_timed = limits.deadline != SearchLimits::Clock::time_point::max();
+        m_steps = 0;
+        m_stopped = false;
+        if (m_timed && SearchLimits::Clock::now() >= m_deadline)
+        {
+            Stop(SearchStop::Deadline);
+        }
+    }
+
+    bool Stopped() const
+    {
+        return m_stopped;
+    }
+
+    // Counts a search step, true once the search has to stop.
+    bool Step()
+    {
+        if (m_timed && ++m_steps == SearchLimits::DeadlineCheckInterval)
+        {
+            m_steps = 0;
+            if (SearchLimits::Clock::now() >= m_deadline)
+            {
+                Stop(SearchStop::Deadline);
+            }
+        }
+        return m_stopped;
+    }
+
+    // The part of a node's word mask (1 forward, 2 reversed, 3 both) that still fits under
+    // max_results, counted as reported. Stops the search when max_results is reached.
+    int Take(int mask)
+    {
+        if (m_max_results && mask == 3 && m_status.results + 1 == m_max_results)
+        {
+            mask = 1;
+        }
+        m_status.results += mask == 3 ? 2 : 1;
+        if (m_max_results && m_status.results >= m_max_results)
+        {
+            Stop(SearchStop::MaxResults);
+        }
+        return mask;
+    }
+
+    void CellSearched()
+    {
+        ++m_status.cells_searched;
+    }
+
+    const SearchStatus& Status() const
+    {
+        return m_status;
+    }
+
+private:
+    void Stop(SearchStop stop)
+    {
+        m_stopped = true;
+        m_status.stop = stop;
+    }
+
+    SearchStatus m_status;
+    uint64_t m_max_results{ 0 };
+    SearchLimits::Clock::time_point m_deadline;
+    uint32_t m_steps{ 0 };
+    bool m_timed{ false };
+    bool m_stopped{ false };
+};
@@ -0,0 +1,700 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "BatchPipeline.hpp"
+#include "Dictionary.hpp"
+#include "ResultSink.hpp"
+
+using namespace std;
+
+// A long-running search process: the dictionary is loaded once and boards come in over a Unix
+// domain socket. Linux only.
+//
+// Every message is a frame of a 9 byte header and a payload, integers little-endian:
+//
+//   u32 payload length, u8 type (ServiceMessage), u32 tag
+//
+// The tag is chosen by the client and comes back with the answer. A connection may have any number
+// of queries in flight and the answers come in the order they are done, not the order they were
+// sent. Boards and words are symbols (Alphabet.hpp), one byte each; for the Latin alphabet that is
+// letter - 'a'.
+enum class ServiceMessage : uint8_t
+{
+    Query = 1,       // u16 rows, u16 columns, rows * columns symbols row by row
+    Stats = 2,       // empty
+    Words = 0x81,    // u32 count, then per word: u32 word id, u16 length, length symbols
+    StatsJson = 0x82, // JSON text, see SearchServer::StatsJson
+    Error = 0xff,    // message text
+};
+
+constexpr size_t ServiceFrameHeader = 9;
+constexpr uint32_t ServiceMaxPayload = 1u << 24;
+
+inline void AppendU16(string& out, uint16_t value)
+{
+    out += char(value & 0xff);
+    out += char(value >> 8);
+}
+
+inline void AppendU32(string& out, uint32_t value)
+{
+    for (int k = 0; k < 4; ++k)
+    {
+        out += char((value >> (8 * k)) & 0xff);
+    }
+}
+
+inline uint16_t ReadU16(const char* p)
+{
+    return uint16_t(uint8_t(p[0]) | uint8_t(p[1]) << 8);
+}
+
+inline uint32_t ReadU32(const char* p)
+{
+    return uint32_t(uint8_t(p[0])) | uint32_t(uint8_t(p[1])) << 8 | uint32_t(uint8_t(p[2])) << 16 | uint32_t(uint8_t(p[3])) << 24;
+}
+
+// Starts a frame in out, the payload is appended after it and EndFrame() fills in its length.
+inline void BeginFrame(string& out, ServiceMessage type, uint32_t tag)
+{
+    out.clear();
+    AppendU32(out, 0);
+    out += char(type);
+    AppendU32(out, tag);
+}
+
+inline void EndFrame(string& out)
+{
+    const uint32_t length = uint32_t(out.size() - ServiceFrameHeader);
+    for (int k = 0; k < 4; ++k)
+    {
+        out[k] = char((length >> (8 * k)) & 0xff);
+    }
+}
+
+inline bool SendAll(int fd, const char* data, size_t size)
+{
+    while (size)
+    {
+        const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+inline bool ReceiveAll(int fd, char* data, size_t size)
+{
+    while (size)
+    {
+        const ssize_t received = recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+inline sockaddr_un ServiceAddress(const string& path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        throw runtime_error("socket path too long: " + path);
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+// Microsecond latencies in log-linear buckets, 16 per power of two, so a percentile is off by less
+// than 1/16. Record() can be called from any thread.
+class LatencyHistogram
+{
+public:
+    void Record(uint64_t us)
+    {
+        m_counts[Bucket(us)].fetch_add(1, memory_order_relaxed);
+        m_count.fetch_add(1, memory_order_relaxed);
+        m_sum.fetch_add(us, memory_order_relaxed);
+        uint64_t max_us = m_max.load(memory_order_relaxed);
+        while (us > max_us && !m_max.compare_exchange_weak(max_us, us, memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t Count() const
+    {
+        return m_count.load(memory_order_relaxed);
+    }
+
+    double Mean() const
+    {
+        const uint64_t count{ Count() };
+        return count ? double(m_sum.load(memory_order_relaxed)) / count : 0;
+    }
+
+    uint64_t Max() const
+    {
+        return m_max.load(memory_order_relaxed);
+    }
+
+    // Upper bound of the bucket holding the q-th fraction of the samples.
+    uint64_t Percentile(double q) const
+    {
+        uint64_t total{ 0 };
+        for (auto& count : m_counts)
+        {
+            total += count.load(memory_order_relaxed);
+        }
+        const uint64_t rank = max<uint64_t>(1, uint64_t(q * total + 0.999999));
+        uint64_t seen{ 0 };
+        for (int b = 0; b < Buckets; ++b)
+        {
+            seen += m_counts[b].load(memory_order_relaxed);
+            if (seen >= rank)
+            {
+                return min(BucketTop(b), Max());
+            }
+        }
+        return Max();
+    }
+
+    void WriteJson(ostream& out) const
+    {
+        out << "{\"count\":" << Count() << ",\"mean\":" << Mean() << ",\"p50\":" << Percentile(0.5)
+            << ",\"p90\":" << Percentile(0.9) << ",\"p99\":" << Percentile(0.99) << ",\"p999\":" << Percentile(0.999)
+            << ",\"max\":" << Max() << "}";
+    }
+
+private:
+    static constexpr int SubBuckets = 16;
+    static constexpr int Buckets = SubBuckets + 60 * SubBuckets;
+
+    atomic<uint64_t> m_counts[Buckets] = {};
+    atomic<uint64_t> m_count{ 0 };
+    atomic<uint64_t> m_sum{ 0 };
+    atomic<uint64_t> m_max{ 0 };
+
+    // Values under 16 have a bucket each, above that a power of two 2^e is split into 16.
+    static int Bucket(uint64_t value)
+    {
+        if (value < SubBuckets)
+        {
+            return int(value);
+        }
+        int e = 4;
+        while (value >> (e + 1))
+        {
+            ++e;
+        }
+        return SubBuckets + (e - 4) * SubBuckets + int((value >> (e - 4)) & (SubBuckets - 1));
+    }
+
+    static uint64_t BucketTop(int bucket)
+    {
+        if (bucket < SubBuckets)
+        {
+            return bucket;
+        }
+        const int e = 4 + (bucket - SubBuckets) / SubBuckets;
+        const uint64_t sub = (bucket - SubBuckets) % SubBuckets;
+        return ((SubBuckets + sub + 1) << (e - 4)) - 1;
+    }
+};
+
+struct ServiceOptions
+{
+    int threads{ 0 };        // search workers, 0 - one per core
+    int batch_us{ 100 };     // how long a batch waits for more queries after its first one
+    size_t max_batch{ 16 };  // queries per batch
+    size_t max_queued{ 4096 }; // queries read but not batched yet, reading stops while it is full
+};
+
+// The server. Run() accepts connections and reads queries on the calling thread; a batcher thread
+// groups queries that arrive within batch_us of each other and a fixed pool of workers runs every
+// batch back to back on one thread, with that thread's DictionaryQuery and result buffers, so the
+// trie stays warm in its cache and nothing is allocated per query once the buffers have grown.
+// Answers are sent by the workers; a client that stops reading holds up the worker that answers it.
+class SearchServer
+{
+public:
+    SearchServer(const Dictionary& dictionary, ServiceOptions options) :
+        m_dictionary(dictionary),
+        m_options(options),
+        m_jobs(max<size_t>(options.max_queued, 1)),
+        m_batches(1)
+    {
+        if (m_options.threads <= 0)
+        {
+            m_options.threads = max(1u, thread::hardware_concurrency());
+        }
+        m_options.max_batch = max<size_t>(m_options.max_batch, 1);
+        if (pipe(m_wake) != 0)
+        {
+            throw runtime_error("can't create the wake-up pipe");
+        }
+    }
+
+    ~SearchServer()
+    {
+        close(m_wake[0]);
+        close(m_wake[1]);
+    }
+
+    // Serves the socket at path until Stop(). An existing file at path is replaced.
+    void Run(const string& path)
+    {
+        const sockaddr_un address{ ServiceAddress(path) };
+        const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0)
+        {
+            throw runtime_error("can't create a socket");
+        }
+        unlink(path.c_str());
+        if (bind(listener, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 128) != 0)
+        {
+            close(listener);
+            throw runtime_error("can't listen on " + path);
+        }
+
+        m_start = chrono::steady_clock::now();
+        thread batcher([&] { Batch(); });
+        vector<thread> workers;
+        for (int t = 0; t < m_options.threads; ++t)
+        {
+            workers.emplace_back([&] { Work(); });
+        }
+
+        vector<shared_ptr<Connection>> connections;
+        vector<pollfd> polled;
+        vector<char> chunk(1 << 16);
+        for (;;)
+        {
+            polled.clear();
+            polled.push_back({ m_wake[0], POLLIN, 0 });
+            polled.push_back({ listener, POLLIN, 0 });
+            for (auto& connection : connections)
+            {
+                polled.push_back({ connection->fd, POLLIN, 0 });
+            }
+            if (poll(polled.data(), polled.size(), -1) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                break;
+            }
+            if (polled[0].revents)
+            {
+                break;
+            }
+            if (polled[1].revents & POLLIN)
+            {
+                const int fd = accept(listener, nullptr, nullptr);
+                if (fd >= 0)
+                {
+                    connections.push_back(make_shared<Connection>(fd));
+                    m_connections.fetch_add(1, memory_order_relaxed);
+                }
+            }
+
+            // Readable connections, the new one isn't polled yet.
+            for (size_t k = 2; k < polled.size(); ++k)
+            {
+                if (!polled[k].revents)
+                {
+                    continue;
+                }
+                const shared_ptr<Connection>& connection{ connections[k - 2] };
+                const ssize_t received = recv(connection->fd, chunk.data(), chunk.size(), MSG_DONTWAIT);
+                if (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    continue;
+                }
+                if (received <= 0 || !Read(connection, chunk.data(), size_t(received)))
+                {
+                    connection->closed = true;
+                }
+            }
+            // Queued queries keep their connection until they are answered.
+            connections.erase(remove_if(connections.begin(), connections.end(),
+                [](const shared_ptr<Connection>& connection) { return connection->closed; }), connections.end());
+        }
+
+        connections.clear();
+        m_jobs.close();
+        batcher.join();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        close(listener);
+        unlink(path.c_str());
+    }
+
+    // Makes Run() return once the queued queries are answered. Safe in a signal handler.
+    void Stop()
+    {
+        const char byte{ 0 };
+        (void)!write(m_wake[1], &byte, 1);
+    }
+
+    // Counters since Run() started and the latencies in microseconds: queue from reading a query to
+    // its batch starting, latency from reading it to its answer being sent.
+    string StatsJson() const
+    {
+        ostringstream out;
+        const double seconds = chrono::duration<double>(chrono::steady_clock::now() - m_start).count();
+        const uint64_t batches{ m_batch_count.load(memory_order_relaxed) };
+        out << "{\"uptime_s\":" << seconds
+            << ",\"connections\":" << m_connections.load(memory_order_relaxed)
+            << ",\"queries\":" << m_latency.Count()
+            << ",\"errors\":" << m_errors.load(memory_order_relaxed)
+            << ",\"words\":" << m_words.load(memory_order_relaxed)
+            << ",\"batches\":" << batches
+            << ",\"mean_batch\":" << (batches ? double(m_batched.load(memory_order_relaxed)) / batches : 0)
+            << ",\"threads\":" << m_options.threads
+            << ",\"queue_us\":";
+        m_queue.WriteJson(out);
+        out << ",\"latency_us\":";
+        m_latency.WriteJson(out);
+        out << "}";
+        return out.str();
+    }
+
+private:
+    using Clock = chrono::steady_clock;
+
+    struct Connection
+    {
+        int fd;
+        bool closed{ false }; // read side, Run() only
+        string input;         // bytes of an unfinished frame, Run() only
+        mutex send_mutex;
+        bool broken{ false }; // a send failed, guarded by send_mutex
+
+        Connection(int socket) : fd(socket)
+        {
+        }
+
+        ~Connection()
+        {
+            close(fd);
+        }
+
+        void Send(const string& frame)
+        {
+            lock_guard<mutex> lock(send_mutex);
+            broken = broken || !SendAll(fd, frame.data(), frame.size());
+        }
+    };
+
+    struct Job
+    {
+        shared_ptr<Connection> connection;
+        uint32_t tag{ 0 };
+        vector<vector<char>> board;
+        Clock::time_point received;
+    };
+
+    const Dictionary& m_dictionary;
+    ServiceOptions m_options;
+    BoundedQueue<Job> m_jobs;
+    BoundedQueue<vector<Job>> m_batches; // one batch waits while the workers are busy
+    int m_wake[2];
+    Clock::time_point m_start{ Clock::now() };
+    atomic<uint64_t> m_connections{ 0 };
+    atomic<uint64_t> m_errors{ 0 };
+    atomic<uint64_t> m_words{ 0 };
+    atomic<uint64_t> m_batch_count{ 0 };
+    atomic<uint64_t> m_batched{ 0 };
+    LatencyHistogram m_queue;
+    LatencyHistogram m_latency;
+
+    static uint64_t Microseconds(Clock::duration duration)
+    {
+        return uint64_t(chrono::duration_cast<chrono::microseconds>(duration).count());
+    }
+
+    // Appends received bytes and handles the frames they complete. False on a malformed stream.
+    bool Read(const shared_ptr<Connection>& connection, const char* data, size_t size)
+    {
+        string& input{ connection->input };
+        input.append(data, size);
+        size_t used{ 0 };
+        while (input.size() - used >= ServiceFrameHeader)
+        {
+            const char* frame{ input.data() + used };
+            const uint32_t length{ ReadU32(frame) };
+            if (length > ServiceMaxPayload)
+            {
+                return false;
+            }
+            if (input.size() - used < ServiceFrameHeader + length)
+            {
+                break;
+            }
+            Handle(connection, ServiceMessage(uint8_t(frame[4])), ReadU32(frame + 5), frame + ServiceFrameHeader, length);
+            used += ServiceFrameHeader + length;
+        }
+        input.erase(0, used);
+        return true;
+    }
+
+    void Handle(const shared_ptr<Connection>& connection, ServiceMessage type, uint32_t tag, const char* payload, uint32_t length)
+    {
+        string frame;
+        if (type == ServiceMessage::Stats)
+        {
+            BeginFrame(frame, ServiceMessage::StatsJson, tag);
+            frame += StatsJson();
+            EndFrame(frame);
+            connection->Send(frame);
+            return;
+        }
+
+        string error;
+        Job job;
+        if (type != ServiceMessage::Query)
+        {
+            error = "unknown message type";
+        }
+        else
+        {
+            ParseBoard(payload, length, job.board, error);
+        }
+        if (!error.empty())
+        {
+            m_errors.fetch_add(1, memory_order_relaxed);
+            BeginFrame(frame, ServiceMessage::Error, tag);
+            frame += error;
+            EndFrame(frame);
+            connection->Send(frame);
+            return;
+        }
+        job.connection = connection;
+        job.tag = tag;
+        job.received = Clock::now();
+        m_jobs.push(move(job));
+    }
+
+    // Sets error if the payload isn't a board of the dictionary's symbols.
+    void ParseBoard(const char* payload, uint32_t length, vector<vector<char>>& board, string& error) const
+    {
+        if (length < 4)
+        {
+            error = "truncated query";
+            return;
+        }
+        const int rows = ReadU16(payload);
+        const int columns = ReadU16(payload + 2);
+        if (!rows || !columns || length != 4 + uint32_t(rows) * columns)
+        {
+            error = "board size doesn't match the payload";
+            return;
+        }
+        const int letters = m_dictionary.Letters().size();
+        board.assign(rows, vector<char>(columns));
+        const char* cells = payload + 4;
+        for (int i = 0; i < rows; ++i)
+        {
+            for (int j = 0; j < columns; ++j)
+            {
+                const int symbol = uint8_t(*cells++);
+                if (symbol >= letters)
+                {
+                    error = "symbol outside the dictionary's alphabet";
+                    return;
+                }
+                board[i][j] = SymbolChar(symbol);
+            }
+        }
+    }
+
+    // Waits for a query, then gives the ones that follow within batch_us a ride in the same batch.
+    void Batch()
+    {
+        Job job;
+        while (m_jobs.pop(job))
+        {
+            vector<Job> batch;
+            const Clock::time_point deadline{ job.received + chrono::microseconds(m_options.batch_us) };
+            batch.push_back(move(job));
+            while (batch.size() < m_options.max_batch && m_jobs.pop_until(job, deadline))
+            {
+                batch.push_back(move(job));
+            }
+            m_batches.push(move(batch));
+        }
+        m_batches.close();
+    }
+
+    void Work()
+    {
+        DictionaryQuery query;
+        ResultArena found;
+        string frame;
+        vector<Job> batch;
+        while (m_batches.pop(batch))
+        {
+            m_batch_count.fetch_add(1, memory_order_relaxed);
+            m_batched.fetch_add(batch.size(), memory_order_relaxed);
+            const Clock::time_point started{ Clock::now() };
+            for (Job& job : batch)
+            {
+                m_queue.Record(Microseconds(started - job.received));
+                found.clear();
+                query.FindWords(m_dictionary, job.board, found);
+                m_words.fetch_add(found.size(), memory_order_relaxed);
+
+                BeginFrame(frame, ServiceMessage::Words, job.tag);
+                AppendU32(frame, uint32_t(found.size()));
+                for (size_t k = 0; k < found.size(); ++k)
+                {
+                    const string_view word{ found.word(k) };
+                    AppendU32(frame, found.id(k));
+                    AppendU16(frame, uint16_t(word.size()));
+                    for (char c : word)
+                    {
+                        frame += char(Symbol(c));
+                    }
+                }
+                EndFrame(frame);
+                job.connection->Send(frame);
+                m_latency.Record(Microseconds(Clock::now() - job.received));
+                job.connection.reset();
+            }
+        }
+    }
+};
+
+// Blocking client of a SearchServer, one connection.
+class SearchClient
+{
+public:
+    SearchClient(const string& path)
+    {
+        const sockaddr_un address{ ServiceAddress(path) };
+        m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_fd < 0 || connect(m_fd, (const sockaddr*)&address, sizeof(address)) != 0)
+        {
+            if (m_fd >= 0)
+            {
+                close(m_fd);
+            }
+            throw runtime_error("can't connect to " + path);
+        }
+    }
+
+    SearchClient(const SearchClient&) = delete;
+    SearchClient& operator=(const SearchClient&) = delete;
+
+    ~SearchClient()
+    {
+        close(m_fd);
+    }
+
+    // board in symbols as the grids take it, char('a' + symbol).
+    void SendQuery(uint32_t tag, const vector<vector<char>>& board)
+    {
+        BeginFrame(m_frame, ServiceMessage::Query, tag);
+        AppendU16(m_frame, uint16_t(board.size()));
+        AppendU16(m_frame, uint16_t(board[0].size()));
+        for (auto& row : board)
+        {
+            for (char c : row)
+            {
+                m_frame += char(Symbol(c));
+            }
+        }
+        Send();
+    }
+
+    void SendStats(uint32_t tag)
+    {
+        BeginFrame(m_frame, ServiceMessage::Stats, tag);
+        Send();
+    }
+
+    // The next answer, payload as sent. Throws if the connection is gone.
+    void Receive(ServiceMessage& type, uint32_t& tag, string& payload)
+    {
+        char header[ServiceFrameHeader];
+        if (!ReceiveAll(m_fd, header, sizeof(header)))
+        {
+            throw runtime_error("connection closed");
+        }
+        type = ServiceMessage(uint8_t(header[4]));
+        tag = ReadU32(header + 5);
+        payload.resize(ReadU32(header));
+        if (!ReceiveAll(m_fd, &payload[0], payload.size()))
+        {
+            throw runtime_error("connection closed");
+        }
+    }
+
+    // The words of a Words payload, char('a' + symbol) like the grids.
+    static vector<string> Words(const string& payload)
+    {
+        vector<string> words;
+        const uint32_t count = ReadU32(payload.data());
+        size_t pos{ 4 };
+        for (uint32_t k = 0; k < count; ++k)
+        {
+            const uint16_t length = ReadU16(payload.data() + pos + 4);
+            pos += 6;
+            words.emplace_back();
+            for (uint16_t i = 0; i < length; ++i)
+            {
+                words.back() += SymbolChar(uint8_t(payload[pos + i]));
+            }
+            pos += length;
+        }
+        return words;
+    }
+
+private:
+    int m_fd{ -1 };
+    string m_frame;
+
+    void Send()
+    {
+        EndFrame(m_frame);
+        if (!SendAll(m_fd, m_frame.data(), m_frame.size()))
+        {
+            throw runtime_error("connection closed");
+        }
+    }
+};
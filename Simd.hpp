@@ -0,0 +1,357 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Alphabet.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WORDSEARCH_X86 1
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// GCC and Clang need the target attribute to emit wider instructions without building the whole
+// program for that target. MSVC allows the intrinsics anywhere.
+#if defined(WORDSEARCH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define WORDSEARCH_TARGET(t) __attribute__((target(t)))
+#else
+#define WORDSEARCH_TARGET(t)
+#endif
+
+using namespace std;
+
+inline int ctz64(uint64_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, x);
+    return (int)idx;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+inline int popcount(uint32_t x)
+{
+#if defined(_MSC_VER)
+    return (int)__popcnt(x);
+#elif defined(__POPCNT__)
+    return __builtin_popcount(x);
+#else
+    // Without -mpopcnt the builtin is a library call.
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    return (int)((((x + (x >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24);
+#endif
+}
+
+inline int popcount64(uint64_t x)
+{
+#if defined(_MSC_VER)
+    return (int)__popcnt64(x);
+#elif defined(__POPCNT__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    return (int)((((x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full) * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// Vectorized kernels for SuffixTree::Build, picked once at startup from what the CPU supports.
+// WORDSEARCH_SIMD=scalar|sse42|avx2|avx512 caps the level, e.g. to compare against the scalar code.
+enum class SimdLevel
+{
+    Scalar,
+    SSE42,
+    AVX2,
+    AVX512,
+};
+
+inline const char* SimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::SSE42: return "sse42";
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+inline SimdLevel DetectSimdLevel()
+{
+    SimdLevel level{ SimdLevel::Scalar };
+#if defined(WORDSEARCH_X86)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool sse42 = (info[2] >> 20) & 1;
+    const bool osxsave = (info[2] >> 27) & 1;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool avx2{ false };
+    bool avx512bw{ false };
+    if (max_leaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = ((info[1] >> 5) & 1) && (xcr0 & 0x6) == 0x6;
+        avx512bw = ((info[1] >> 30) & 1) && ((info[1] >> 16) & 1) && (xcr0 & 0xe6) == 0xe6;
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse42 = __builtin_cpu_supports("sse4.2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    const bool avx512bw = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+    if (avx512bw) level = SimdLevel::AVX512;
+    else if (avx2) level = SimdLevel::AVX2;
+    else if (sse42) level = SimdLevel::SSE42;
+#endif
+    if (const char* cap = getenv("WORDSEARCH_SIMD"))
+    {
+        for (SimdLevel l : { SimdLevel::Scalar, SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512 })
+        {
+            if (strcmp(cap, SimdLevelName(l)) == 0 && l < level)
+            {
+                level = l;
+            }
+        }
+    }
+    return level;
+}
+
+inline SimdLevel ActiveSimdLevel()
+{
+    static const SimdLevel level{ DetectSimdLevel() };
+    return level;
+}
+
+// --- common prefix length -------------------------------------------------------------------
+
+inline size_t CommonPrefixScalar(const char* a, const char* b, size_t n)
+{
+    size_t i = 0;
+    while (i < n && a[i] == b[i])
+    {
+        ++i;
+    }
+    return i;
+}
+
+#if defined(WORDSEARCH_X86)
+WORDSEARCH_TARGET("sse4.2")
+inline size_t CommonPrefixSSE42(const char* a, const char* b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+        const unsigned diff = ~(unsigned)_mm_movemask_epi8(eq) & 0xffffu;
+        if (diff)
+        {
+            return i + ctz64(diff);
+        }
+    }
+    return i + CommonPrefixScalar(a + i, b + i, n - i);
+}
+
+WORDSEARCH_TARGET("avx2")
+inline size_t CommonPrefixAVX2(const char* a, const char* b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        const __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+        const uint32_t diff = ~(uint32_t)_mm256_movemask_epi8(eq);
+        if (diff)
+        {
+            return i + ctz64(diff);
+        }
+    }
+    return i + CommonPrefixSSE42(a + i, b + i, n - i);
+}
+
+WORDSEARCH_TARGET("avx512f,avx512bw")
+inline size_t CommonPrefixAVX512(const char* a, const char* b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64)
+    {
+        const uint64_t diff = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        if (diff)
+        {
+            return i + ctz64(diff);
+        }
+    }
+    return i + CommonPrefixAVX2(a + i, b + i, n - i);
+}
+#endif
+
+inline size_t CommonPrefix(const char* a, const char* b, size_t n)
+{
+    // Short patterns are the common case, the vector loops only start paying off past a block.
+    if (n < 16)
+    {
+        return CommonPrefixScalar(a, b, n);
+    }
+#if defined(WORDSEARCH_X86)
+    switch (ActiveSimdLevel())
+    {
+    case SimdLevel::AVX512: return CommonPrefixAVX512(a, b, n);
+    case SimdLevel::AVX2: return CommonPrefixAVX2(a, b, n);
+    case SimdLevel::SSE42: return CommonPrefixSSE42(a, b, n);
+    default: break;
+    }
+#endif
+    return CommonPrefixScalar(a, b, n);
+}
+
+// --- letter feasibility ---------------------------------------------------------------------
+
+// Symbol counts of the board, saturated to 255, one lane per symbol so a word's counts can be
+// checked against all of them in a few compares. exact holds the unsaturated counts. The board
+// has to be symbols only, see CheckBoard.
+struct LetterBudget
+{
+    alignas(64) uint8_t counts[MaxSymbols];
+    int exact[MaxSymbols];
+    size_t grid_size{ 0 };
+
+    LetterBudget(const vector<vector<char>>& board)
+    {
+        memset(exact, 0, sizeof(exact));
+        for (auto& row : board)
+        {
+            for (char c : row)
+            {
+                ++exact[Symbol(c)];
+            }
+        }
+        for (int i = 0; i < MaxSymbols; ++i)
+        {
+            counts[i] = (uint8_t)min(exact[i], 255);
+        }
+        grid_size = board.size() * board[0].size();
+    }
+};
+
+// Words longer than 255 letters can overflow a byte counter; they take the exact scalar path.
+// Same loop as the original occ_table check in Build.
+inline bool FeasibleScalar(const string& word, const LetterBudget& budget)
+{
+    int occ[MaxSymbols];
+    memcpy(occ, budget.exact, sizeof(occ));
+    for (char c : word)
+    {
+        if (!IsSymbol(c) || --occ[Symbol(c)] < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// False if the word has a byte that is not a symbol, such a word fits no board.
+inline bool WordHistogram(const string& word, uint8_t* counts)
+{
+    memset(counts, 0, MaxSymbols);
+    for (char c : word)
+    {
+        if (!IsSymbol(c))
+        {
+            return false;
+        }
+        ++counts[Symbol(c)];
+    }
+    return true;
+}
+
+// The vector versions run the whole batch inside one target function, so the per-word compare is
+// inlined instead of being a call across targets.
+#define WORDSEARCH_FEASIBLE_BATCH(fits)                                 \
+    alignas(64) uint8_t counts[MaxSymbols];                             \
+    for (size_t i = 0; i < words.size(); ++i)                           \
+    {                                                                   \
+        const string& word{ words[i] };                                 \
+        if (word.size() > budget.grid_size)                             \
+        {                                                               \
+            feasible[i] = 0;                                            \
+        }                                                               \
+        else if (word.size() > 255)                                     \
+        {                                                               \
+            feasible[i] = FeasibleScalar(word, budget);                 \
+        }                                                               \
+        else                                                            \
+        {                                                               \
+            feasible[i] = WordHistogram(word, counts) && (fits);        \
+        }                                                               \
+    }
+
+#if defined(WORDSEARCH_X86)
+// counts <= budget  <=>  max(counts, budget) == budget, 16 lanes at a time
+WORDSEARCH_TARGET("sse4.2")
+inline __m128i FitsSSE42(const uint8_t* counts, const uint8_t* budget, int lane)
+{
+    const __m128i board = _mm_load_si128((const __m128i*)(budget + lane));
+    return _mm_cmpeq_epi8(_mm_max_epu8(_mm_load_si128((const __m128i*)(counts + lane)), board), board);
+}
+
+WORDSEARCH_TARGET("sse4.2")
+inline void FeasibleWordsSSE42(const vector<string>& words, const LetterBudget& budget, uint8_t* feasible)
+{
+    static_assert(MaxSymbols == 64, "the kernels compare 64 lanes");
+    WORDSEARCH_FEASIBLE_BATCH(_mm_movemask_epi8(_mm_and_si128(
+        _mm_and_si128(FitsSSE42(counts, budget.counts, 0), FitsSSE42(counts, budget.counts, 16)),
+        _mm_and_si128(FitsSSE42(counts, budget.counts, 32), FitsSSE42(counts, budget.counts, 48)))) == 0xffff)
+}
+
+WORDSEARCH_TARGET("avx2")
+inline void FeasibleWordsAVX2(const vector<string>& words, const LetterBudget& budget, uint8_t* feasible)
+{
+    const __m256i board_lo = _mm256_load_si256((const __m256i*)budget.counts);
+    const __m256i board_hi = _mm256_load_si256((const __m256i*)(budget.counts + 32));
+    WORDSEARCH_FEASIBLE_BATCH((uint32_t)_mm256_movemask_epi8(_mm256_and_si256(
+        _mm256_cmpeq_epi8(_mm256_max_epu8(_mm256_load_si256((const __m256i*)counts), board_lo), board_lo),
+        _mm256_cmpeq_epi8(_mm256_max_epu8(_mm256_load_si256((const __m256i*)(counts + 32)), board_hi), board_hi))) == 0xffffffffu)
+}
+
+WORDSEARCH_TARGET("avx512f,avx512bw")
+inline void FeasibleWordsAVX512(const vector<string>& words, const LetterBudget& budget, uint8_t* feasible)
+{
+    const __m512i board = _mm512_load_si512((const void*)budget.counts);
+    WORDSEARCH_FEASIBLE_BATCH(_mm512_cmpgt_epu8_mask(_mm512_load_si512((const void*)counts), board) == 0)
+}
+#endif
+
+#undef WORDSEARCH_FEASIBLE_BATCH
+
+// Sets feasible[i] for every word that fits on the board: symbols only, not longer than the board
+// and no letter used more often than the board has it. Same answer as the scalar occ_table loop in
+// Build, but the word is counted into a 64-byte histogram, one lane per symbol, and compared
+// against the board in one to four vector compares.
+inline void FeasibleWords(const vector<string>& words, const LetterBudget& budget, vector<uint8_t>& feasible)
+{
+    feasible.resize(words.size());
+#if defined(WORDSEARCH_X86)
+    switch (ActiveSimdLevel())
+    {
+    case SimdLevel::AVX512: FeasibleWordsAVX512(words, budget, feasible.data()); return;
+    case SimdLevel::AVX2: FeasibleWordsAVX2(words, budget, feasible.data()); return;
+    case SimdLevel::SSE42: FeasibleWordsSSE42(words, budget, feasible.data()); return;
+    default: break;
+    }
+#endif
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        feasible[i] = words[i].size() <= budget.grid_size && FeasibleScalar(words[i], budget);
+    }
+}
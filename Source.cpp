@@ -5,253 +5,314 @@
 #include <string>
 #include <string_view>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <chrono>
-#include <unordered_map>
+#include <fstream>
+#include <stdexcept>
+#include <memory>
 #include "SuffixTree.hpp"
+#include "WordFinder.hpp"
+#include "BoardWordFinder.hpp"
+#include "ParallelWordFinder.hpp"
+#include "Dictionary.hpp"
+#include "TopKQuery.hpp"
+#include "BatchPipeline.hpp"
+#include "Profiler.hpp"
+#if defined(__linux__)
+#include <csignal>
+#include "SearchService.hpp"
+#endif
 
 using namespace std;
 
 
-class ChronoProfiler
+// WORDSEARCH_PROFILE_JSON=<file> and WORDSEARCH_TRACE=<file> export the profile when the run ends,
+// as the JSON summary or as a Chrome trace.
+void StartProfile()
 {
-public:
-    ChronoProfiler(const std::string& name) : m_name(name), m_start(std::chrono::steady_clock::now())
+    if (getenv("WORDSEARCH_TRACE"))
     {
+        Profiler::EnableTrace(true);
     }
+}
 
-    ~ChronoProfiler()
+void WriteProfile()
+{
+    if (const char* path = getenv("WORDSEARCH_PROFILE_JSON"))
     {
-        auto end = std::chrono::steady_clock::now();
-        auto elapsed_time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count();
-
-        // Add elapsed time to timer with the same name
-        s_timers[m_name] += elapsed_time;
+        ofstream file(path);
+        Profiler::WriteJson(file);
     }
-
-    // Static function to print elapsed time for a specific timer
-    static void printTime(const std::string& name)
+    if (const char* path = getenv("WORDSEARCH_TRACE"))
     {
-        std::cout << name << " elapsed time: " << s_timers[name] / 1000000 << "ms" << std::endl;
+        ofstream file(path);
+        Profiler::WriteChromeTrace(file);
     }
+}
 
-private:
-    std::string m_name;
-    std::chrono::steady_clock::time_point m_start;
-
-    // Static map to store timers
-    inline static std::unordered_map<std::string, long long> s_timers;
-};
-
-struct cell
+void FindWords(const vector<string>& words, const vector<vector<char>>& board, vector<string>& out)
 {
-    char c{'0'};
-    cell* neighbors[4] = { nullptr, nullptr, nullptr, nullptr };
-    int neighbor{0};
-
-    cell() {}
-    cell(char _c)
-        : c(_c)
-    {}
-};
+    SuffixTree T;
+    {
+        WORDSEARCH_PROFILE_SCOPE("build_tree");
+        T.Build(words, board);
+    }
+    {
+        WORDSEARCH_PROFILE_SCOPE("find_words");
+        FindWordsAuto(T, board, out);
+    }
+}
 
-struct DFSWordFinder
+void FindWordsParallel(const vector<string>& words, const vector<vector<char>>& board, vector<string>& out, int threads_num = 0)
 {
-    vector<string>& out_words;
-    const vector<vector<char>>& board;
-
-    cell* grid;
-    int grid_size;
-    uint8_t n;
-
-    int path[11];
-    int8_t path_index{ 0 };
-
-    DFSWordFinder(const vector<vector<char>>& in_board, vector<string>& words) :
-        board(in_board),
-        out_words(words)
+    SuffixTree T;
+    {
+        WORDSEARCH_PROFILE_SCOPE("build_tree");
+        T.Build(words, board);
+    }
     {
-        uint8_t m = (uint8_t)board.size();
-        n = (uint8_t)board[0].size();
-        grid_size = m * n;
+        WORDSEARCH_PROFILE_SCOPE("find_words_parallel");
+        ParallelWordFinder Finder{ board, out, threads_num };
+        Finder.FindWords(T);
+    }
+}
 
-        grid = new cell[grid_size];
-        int idx{ 0 };
-        for (uint8_t i = 0; i < m; ++i)
+// One word per line. Plain lists keep only lowercase a-z words; utf8 lists keep every line and the
+// dictionary gets the alphabet of its words.
+vector<string> ReadWordList(const string& path, bool utf8 = false)
+{
+    ifstream file(path);
+    if (!file)
+    {
+        throw runtime_error("can't open " + path);
+    }
+    vector<string> words;
+    string line;
+    while (getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
         {
-            for (uint8_t j = 0; j < n; ++j)
-            {
-                cell& c{ grid[idx] };
-                c = cell{ board[i][j] };
-                if (j > 0)
-                {
-                    c.neighbors[0] = &grid[idx - 1];
-                }
-                if (j < n - 1)
-                {
-                    c.neighbors[1] = &grid[idx + 1];
-                }
-                if (i > 0)
-                {
-                    c.neighbors[2] = &grid[idx - n];
-                }
-                if (i < m - 1)
-                {
-                    c.neighbors[3] = &grid[idx + n];
-                }
-                ++idx;
-            }
+            line.pop_back();
+        }
+        if (!line.empty() && (utf8 || all_of(line.begin(), line.end(), [](char c) { return c >= 'a' && c <= 'z'; })))
+        {
+            words.push_back(line);
         }
     }
+    return words;
+}
+
+unique_ptr<Dictionary> MakeDictionary(const vector<string>& words, bool utf8)
+{
+    return unique_ptr<Dictionary>(utf8 ? new Dictionary(Alphabet{ words }, words) : new Dictionary(words));
+}
 
-    bool search_impl(Node& node, const int idx)
+// build-index [--utf8] <wordlist> <index file>
+int BuildIndex(const string& wordlist_path, const string& index_path, bool utf8)
+{
+    const vector<string> words{ ReadWordList(wordlist_path, utf8) };
+    {
+        WORDSEARCH_PROFILE_SCOPE("build_index");
+        MakeDictionary(words, utf8)->Save(index_path);
+    }
     {
-        int path_index_cached = path_index;
-        int start = path[path_index - 1];
-        auto pattern{ node.get_pattern() };
-        pattern.remove_prefix(idx);
+        WORDSEARCH_PROFILE_SCOPE("load_index");
+        auto dictionary = Dictionary::Load(index_path);
+        cout << "indexed " << dictionary->WordCount() << " words of " << words.size() << ", "
+            << dictionary->Tree().nodes_num << " nodes, " << dictionary->Letters().size() << " letters" << endl;
+    }
+    Profiler::PrintSummary(cout);
+    return 0;
+}
 
-        do
+// batch (--index <file> | --words <file> [--utf8]) [--threads N] [--in-flight N] [--unordered] [boards file]
+// Boards are read from the file or stdin, results are written to stdout, throughput to stderr.
+int Batch(int argc, char** argv)
+{
+    unique_ptr<Dictionary> dictionary;
+    BatchOptions options;
+    string input_path;
+    string words_path;
+    bool utf8{ false };
+    for (int i = 2; i < argc; ++i)
+    {
+        const string arg{ argv[i] };
+        const bool has_value{ i + 1 < argc };
+        if (arg == "--index" && has_value)
         {
-            if (path_index == node.pattern.size())
-            {
-                if (node.mask == 1 || node.mask == 3)
-                {
-                    out_words.push_back(string{ node.pattern });
-                }
-                if (node.mask >= 2)
-                {
-                    out_words.push_back(string{ node.pattern });
-                    reverse(out_words.back().begin(), out_words.back().end());
-                }
-                node.mask = -1;
-
-                if (node.children_num)
-                {
-                    for (int i = 0; i < 26; ++i)
-                    {
-                        if (!node.children[i])
-                            continue;
-                        if (search_impl(*node.children[i], 0))
-                        {
-                            delete node.children[i];
-                            node.children[i] = nullptr;
-                            --node.children_num;
-                        }
-                    }
-                }
-                if (!node.children_num)
-                {
-                    for (uint8_t i = path_index_cached; i < path_index; ++i)
-                    {
-                        grid[path[i]].c = board[path[i] / n][path[i] % n];
-                        grid[path[i]].neighbor = 0;
-                    }
-                    grid[path[path_index_cached - 1]].neighbor = 0;
-                    path_index = path_index_cached;
-                    return true;
-                }
-            }
-            else
-            {
-                cell* c = &grid[path[path_index - 1]];
-                const char p = node.pattern[path_index];
-                bool found{ false };
-                for (uint8_t i = c->neighbor; i < 4; ++i)
-                {
-                    if (auto neighbor_cell_ptr{ c->neighbors[i] })
-                    {
-                        auto& neighbor_cell{ *neighbor_cell_ptr };
-                        const int neighbor_cell_index = neighbor_cell_ptr - grid;
-                        if (neighbor_cell.c == p)
-                        {
-                            found = true;
-                            c->neighbor = i + 1;
-                            path[path_index] = neighbor_cell_index;
-                            neighbor_cell.c = '$';
-                            ++path_index;
-                            c = neighbor_cell_ptr;
-                            break;
-                        }
-                    }
-                }
-                if (found)
-                {
-                    continue;
-                }
-                else
-                {
-                    c->neighbor = 0;
-                }
-            }
-            --path_index;
-            if (path_index >= path_index_cached)
-            {
-                grid[path[path_index]].c = board[path[path_index] / n][path[path_index] % n];
-            }
-        } while (path_index >= path_index_cached);
-        grid[path[path_index_cached - 1]].neighbor = 0;
-        path_index = path_index_cached;
-        return false;
+            dictionary = Dictionary::Load(argv[++i]);
+        }
+        else if (arg == "--words" && has_value)
+        {
+            words_path = argv[++i];
+        }
+        else if (arg == "--utf8")
+        {
+            utf8 = true;
+        }
+        else if (arg == "--threads" && has_value)
+        {
+            options.threads = stoi(argv[++i]);
+        }
+        else if (arg == "--in-flight" && has_value)
+        {
+            options.max_in_flight = stoul(argv[++i]);
+        }
+        else if (arg == "--unordered")
+        {
+            options.ordered = false;
+        }
+        else
+        {
+            input_path = arg;
+        }
+    }
+    if (!words_path.empty())
+    {
+        dictionary = MakeDictionary(ReadWordList(words_path, utf8), utf8);
+    }
+    if (!dictionary)
+    {
+        cerr << "batch needs --index or --words" << endl;
+        return 1;
     }
 
-    void FindWords(SuffixTree& Tree)
+    ios::sync_with_stdio(false);
+    ifstream input_file;
+    if (!input_path.empty() && input_path != "-")
     {
-        char cell_char;
-        for (int i = 0; i < grid_size; ++i)
+        input_file.open(input_path);
+        if (!input_file)
         {
-            cell_char = grid[i].c;
-            if (auto& Root = Tree.Roots[cell_char - 97])
-            {
-                auto root_pattern{ Root->pattern };
-                path_index = 1;
-                path[0] = i;
-                grid[i].c = '$';
-                if (search_impl(*Root, 1))
-                {
-                    delete Root;
-                    Root = nullptr;
-                }
-                grid[i].c = cell_char;
-            }
+            throw runtime_error("can't open " + input_path);
         }
-        return;
     }
+    istream& input{ input_file.is_open() ? input_file : cin };
 
-    //void DFS(Node& Node)
-    //{
-    //    if (!SearchSuffixes(Node))
-    //    {
-    //        return;
-    //    }
-    //    for (auto& c : Node.children)
-    //    {
-    //        if (c)
-    //        {
-    //            DFS(*c);
-    //        }
-    //    }
-    //    return;
-    //}
-};
+    const BatchStats stats{ RunBatch(*dictionary, input, cout, options) };
+    cerr << stats.boards << " boards (" << stats.rejected << " prefiltered, " << stats.errors << " invalid), "
+        << stats.words << " words in " << stats.seconds << "s: "
+        << stats.boards / max(stats.seconds, 1e-9) << " boards/s, "
+        << stats.words / max(stats.seconds, 1e-9) << " words/s" << endl;
+    return 0;
+}
 
-void FindWords(vector<string>& words, const vector<vector<char>>& board, vector<string>& out)
+#if defined(__linux__)
+SearchServer* g_server{ nullptr };
+
+// serve (--index <file> | --words <file> [--utf8]) --socket <path> [--threads N] [--batch-us N] [--max-batch N]
+// Answers queries on the socket (SearchService.hpp) until SIGINT or SIGTERM.
+int Serve(int argc, char** argv)
 {
-    SuffixTree T;
+    unique_ptr<Dictionary> dictionary;
+    ServiceOptions options;
+    string socket_path;
+    string words_path;
+    bool utf8{ false };
+    for (int i = 2; i < argc; ++i)
     {
-        ChronoProfiler Profiler{ "build_tree" };
-        T.Build(words, board);
+        const string arg{ argv[i] };
+        const bool has_value{ i + 1 < argc };
+        if (arg == "--index" && has_value)
+        {
+            dictionary = Dictionary::Load(argv[++i]);
+        }
+        else if (arg == "--words" && has_value)
+        {
+            words_path = argv[++i];
+        }
+        else if (arg == "--utf8")
+        {
+            utf8 = true;
+        }
+        else if (arg == "--socket" && has_value)
+        {
+            socket_path = argv[++i];
+        }
+        else if (arg == "--threads" && has_value)
+        {
+            options.threads = stoi(argv[++i]);
+        }
+        else if (arg == "--batch-us" && has_value)
+        {
+            options.batch_us = stoi(argv[++i]);
+        }
+        else if (arg == "--max-batch" && has_value)
+        {
+            options.max_batch = stoul(argv[++i]);
+        }
+        else
+        {
+            cerr << "unknown argument " << arg << endl;
+            return 1;
+        }
     }
+    if (!words_path.empty())
     {
-        ChronoProfiler Profiler{ "find_words" };
-        DFSWordFinder Finder{ board, out };
-        Finder.FindWords(T);
+        dictionary = MakeDictionary(ReadWordList(words_path, utf8), utf8);
+    }
+    if (!dictionary || socket_path.empty())
+    {
+        cerr << "serve needs --index or --words and --socket" << endl;
+        return 1;
     }
+
+    SearchServer server{ *dictionary, options };
+    g_server = &server;
+    signal(SIGINT, [](int) { g_server->Stop(); });
+    signal(SIGTERM, [](int) { g_server->Stop(); });
+    cerr << "serving " << dictionary->WordCount() << " words on " << socket_path << endl;
+    server.Run(socket_path);
+    cerr << server.StatsJson() << endl;
+    g_server = nullptr;
+    return 0;
 }
+#endif
 
-int main()
+int main(int argc, char** argv)
 {
+    StartProfile();
+    const string command{ argc > 1 ? argv[1] : "" };
+    if (command == "build-index" || command == "batch" || command == "serve")
+    {
+        try
+        {
+            if (command == "batch")
+            {
+                const int result = Batch(argc, argv);
+                WriteProfile();
+                return result;
+            }
+            if (command == "serve")
+            {
+#if defined(__linux__)
+                const int result = Serve(argc, argv);
+                WriteProfile();
+                return result;
+#else
+                cerr << "serve is only available on Linux" << endl;
+                return 1;
+#endif
+            }
+            const bool utf8{ argc == 5 && string(argv[2]) == "--utf8" };
+            if (argc == 4 || utf8)
+            {
+                const int result = BuildIndex(argv[argc - 2], argv[argc - 1], utf8);
+                WriteProfile();
+                return result;
+            }
+            cerr << "usage: build-index [--utf8] <wordlist> <index file>" << endl;
+            return 1;
+        }
+        catch (const exception& e)
+        {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+
     //std::vector<std::vector<char>> board
     //{
     //    {'o','a','a','n'},
@@ -338,6 +399,63 @@ int main()
         {
             FindWords(words, board, res);
         }
+        vector<string> parallel_res;
+        FindWordsParallel(words, board, parallel_res);
+        sort(res.begin(), res.end());
+        sort(parallel_res.begin(), parallel_res.end());
+        cout << " PARALLEL " << (res == parallel_res ? "matches" : "DIFFERS") << endl;
+
+        Dictionary dictionary{ words };
+        DictionaryQuery query;
+        vector<string> dictionary_res;
+        {
+            WORDSEARCH_PROFILE_SCOPE("find_words_dictionary");
+            query.FindWords(dictionary, board, dictionary_res);
+        }
+        sort(dictionary_res.begin(), dictionary_res.end());
+        cout << " DICTIONARY " << (res == dictionary_res ? "matches" : "DIFFERS") << endl;
+
+        // Stops at the first word; a partial status means there was one.
+        SearchLimits first_word;
+        first_word.exists_only = true;
+        vector<string> any_word;
+        const SearchStatus exists{ query.FindWords(dictionary, board, any_word, first_word) };
+        cout << " EXISTS " << (exists.partial() ? any_word[0] : "none") << " after " << exists.coverage() * 100 << "% of the board" << endl;
+
+        ResultArena arena;
+        query.FindWords(dictionary, board, arena);
+        for (size_t k = 0; k < arena.size(); ++k)
+        {
+            cout << " " << arena.word(k) << ":";
+            for (int c = 0; c < arena.path_length(k); ++c)
+            {
+                cout << " (" << arena.path(k)[c] / board[0].size() << "," << arena.path(k)[c] % board[0].size() << ")";
+            }
+            cout << endl;
+        }
+
+        // The three best words by Scrabble tile values, without finding the rest.
+        const ScoreBounds tile_bounds{ dictionary.Tree(), LetterScores::Scrabble() };
+        TopKQuery top_query;
+        vector<string> top_res;
+        top_query.FindTopWords(dictionary, tile_bounds, board, 3, top_res);
+        for (size_t k = 0; k < top_res.size(); ++k)
+        {
+            cout << " TOP " << top_res[k] << " " << top_query.Score(k) << endl;
+        }
+
+        // Any alphabet of up to MaxSymbols letters, UTF-8 in and out.
+        const vector<string> cyrillic_words{ "кот", "ток", "сок", "кость", "ёж" };
+        const Dictionary cyrillic{ Alphabet{ cyrillic_words }, cyrillic_words };
+        vector<string> cyrillic_res;
+        query.FindWords(cyrillic, cyrillic.Letters().EncodeBoard({ "кот", "ось", "ёжь" }), cyrillic_res);
+        cout << " CYRILLIC";
+        for (const string& word : cyrillic_res)
+        {
+            cout << " " << cyrillic.Letters().Decode(word);
+        }
+        cout << endl;
+
     //    cout << " RESULT:" << endl;
     //    for (auto const& res_word : res)
     //    {
@@ -383,9 +501,7 @@ int main()
             std::cout << "Not found" << '\n';
         }
     }
-    ChronoProfiler::printTime("prune");
-    ChronoProfiler::printTime("build_tree");
-    ChronoProfiler::printTime("find_words");
-    ChronoProfiler::printTime("process_neighbor");
+    Profiler::PrintSummary(cout);
+    WriteProfile();
     return 0;
 }
\ No newline at end of file
@@ -2,233 +2,710 @@
 
 #include <deque>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <thread>
+
+#include "Alphabet.hpp"
+#include "BoardAdjacency.hpp"
+#include "Orientation.hpp"
+#include "Simd.hpp"
+#include "Profiler.hpp"
 
 using namespace std;
 
-int intersection(const string_view& a, const string_view& b)
+inline int intersection(const string_view& a, const string_view& b)
+{
+	return (int)CommonPrefix(a.data(), b.data(), min(a.size(), b.size()));
+}
+
+// Nodes live in SuffixTree::nodes and refer to each other by 32-bit index, 0 is "no node".
+// Children of a node are a packed, symbol-ordered block in SuffixTree::child_pool, children_mask
+// tells which symbols (see Alphabet.hpp) are present. Patterns are stored in SuffixTree::text.
+struct Node
 {
-	int i = 0;
-	while (i < a.size() && i < b.size())
+	uint32_t offset{ 0 };       // pattern = text[offset, offset + length), the whole word prefix up to this node
+	uint16_t length{ 0 };
+	uint16_t prefix_idx{ 0 };   // pattern[0, prefix_idx) belongs to the ancestors
+	uint64_t children_mask{ 0 };
+	uint32_t children{ 0 };     // first slot of the children block in child_pool
+	int8_t mask{ 0 }; // 0 - not a word, 1 - forward, 2 - reversed, 3 - both reversed and forward
+	uint8_t children_num{ 0 };
+	uint16_t reserved{ 0 };     // the padding, spelled out so a saved tree has no undefined bytes
+
+	string_view get_pattern(const char* text) const
 	{
-		if (a[i] != b[i])
-		{
-			return i;
-		}
-		++i;
+		return string_view{ text + offset + prefix_idx, size_t(length - prefix_idx) };
+	}
+
+	string_view pattern(const char* text) const
+	{
+		return string_view{ text + offset, length };
 	}
-	return i;
-}
 
-struct Paths
+	// Slot of the child for symbol c inside the children block.
+	int child_slot(int c) const
+	{
+		return popcount64(children_mask & ((uint64_t(1) << c) - 1));
+	}
+};
+
+// Read-only view of a built tree. It does not care where the arrays live, so the same search code
+// runs on an owned SuffixTree and on a memory-mapped index file.
+struct TrieView
 {
-	struct Path
+	const Node* nodes{ nullptr };
+	uint32_t nodes_num{ 0 };
+	const uint32_t* child_pool{ nullptr };
+	const char* text{ nullptr };
+	uint32_t Roots[MaxSymbols];
+
+	string_view pattern(const Node& node) const
 	{
-		int valid;
-		vector<int> path;
-	};
-	unordered_map<int, vector<Path>> paths;
+		return node.pattern(text);
+	}
+
+	string_view get_pattern(const Node& node) const
+	{
+		return node.get_pattern(text);
+	}
+
+	uint32_t index(const Node& node) const
+	{
+		return uint32_t(&node - nodes);
+	}
 };
 
-struct Node
+struct SuffixTree
 {
-	std::string_view pattern;
-	int prefix_idx;
-	Node* parent{ nullptr };
-	Node* children[26];
-	int children_num{ 0 };
-	int mask{ 0 }; // 0 - not a word, 1 - forward, 2 - reversed, 3 - both reversed and forward
-	Paths paths;
+	uint32_t Roots[MaxSymbols];
+	vector<Node> nodes;
+	vector<uint32_t> child_pool;
+	string text;
+	uint64_t word_count{ 0 };
+	uint32_t max_word_length{ 0 };
+	// Orientation of the words in the board builds, the board independent ones use the runs.
+	OrientationPolicy orientation{ OrientationPolicy::Auto };
+
+	SuffixTree()
+	{
+		memset(Roots, 0, sizeof(Roots));
+		nodes.resize(1);
+	}
+
+	string_view pattern(const Node& node) const
+	{
+		return node.pattern(text.data());
+	}
+
+	TrieView View() const
+	{
+		TrieView view;
+		view.nodes = nodes.data();
+		view.nodes_num = (uint32_t)nodes.size();
+		view.child_pool = child_pool.data();
+		view.text = text.data();
+		copy(Roots, Roots + MaxSymbols, view.Roots);
+		return view;
+	}
+
+	string_view get_pattern(const Node& node) const
+	{
+		return node.get_pattern(text.data());
+	}
 
-	~Node()
+	uint32_t child(const Node& node, int c) const
 	{
-		for (auto& c : children)
+		if (!(node.children_mask & (uint64_t(1) << c)))
 		{
-			if (c)
-			{
-				delete c;
-			}
-			c = nullptr;
+			return 0;
 		}
+		return child_pool[node.children + node.child_slot(c)];
+	}
+
+	uint32_t NewNode(uint32_t offset, size_t length, size_t prefix_idx)
+	{
+		Node node;
+		node.offset = offset;
+		node.length = (uint16_t)length;
+		node.prefix_idx = (uint16_t)prefix_idx;
+		nodes.push_back(node);
+		return (uint32_t)nodes.size() - 1;
+	}
+
+	// Children blocks are immutable while building: adding a child copies the block to the end of
+	// the pool. Compact() drops the stale copies once the tree is built.
+	void AddChild(uint32_t parent, int c, uint32_t node)
+	{
+		Node& p{ nodes[parent] };
+		assert(!(p.children_mask & (uint64_t(1) << c)));
+		const uint32_t block = (uint32_t)child_pool.size();
+		const int slot = p.child_slot(c);
+		child_pool.resize(block + p.children_num + 1);
+		copy(child_pool.begin() + p.children, child_pool.begin() + p.children + slot, child_pool.begin() + block);
+		child_pool[block + slot] = node;
+		copy(child_pool.begin() + p.children + slot, child_pool.begin() + p.children + p.children_num, child_pool.begin() + block + slot + 1);
+		p.children = block;
+		p.children_mask |= uint64_t(1) << c;
+		++p.children_num;
 	}
 
-	string_view get_pattern() const
+	// Used by the destructive search to prune found subtrees.
+	void RemoveChild(Node& parent, int c)
 	{
-		string_view res{ pattern };
-		res.remove_prefix(prefix_idx);
-		return res;
+		const int slot = parent.child_slot(c);
+		auto block = child_pool.begin() + parent.children;
+		copy(block + slot + 1, block + parent.children_num, block + slot);
+		parent.children_mask &= ~(uint64_t(1) << c);
+		--parent.children_num;
 	}
 
-	Node* Insert(const std::string_view& word)
+	// word has to be stored in text and share the first prefix_idx characters with node.
+	uint32_t Insert(uint32_t node_idx, const string_view& word, uint32_t word_offset)
 	{
-		string_view pattern_suffix{ get_pattern() };
-		string_view word_suffix{ word };
-		word_suffix.remove_prefix(prefix_idx);
-		if (int index = intersection(pattern_suffix, word_suffix))
+		while (true)
 		{
+			Node& node{ nodes[node_idx] };
+			string_view pattern_suffix{ get_pattern(node) };
+			string_view word_suffix{ word };
+			word_suffix.remove_prefix(node.prefix_idx);
+			const int index = intersection(pattern_suffix, word_suffix);
 			if (index == 0)
 			{
-				return nullptr;
+				return 0;
 			}
-			else if (index == pattern_suffix.size())
+			const int new_prefix = node.prefix_idx + index;
+			if (index == (int)pattern_suffix.size())
 			{
-				if (index == word_suffix.size())
+				if (index == (int)word_suffix.size())
 				{
-					return this;
+					return node_idx;
 				}
-				int new_prefix{ prefix_idx + index };
-				const auto& c = children[word[new_prefix] - 97];
-				if (c)
+				const int c = Symbol(word[new_prefix]);
+				if (const uint32_t next = child(node, c))
 				{
-					Node* node = c->Insert(word);
-					assert(node);
-					return node;
+					node_idx = next;
+					continue;
 				}
-				Node* node = new Node{ word, new_prefix, {} };
-				assert(node->pattern.size() > prefix_idx);
-				node->parent = this;
-				children[word[new_prefix]-97] = node;
-				++children_num;
-				return node;
+				const uint32_t out_node = NewNode(word_offset, word.size(), new_prefix);
+				AddChild(node_idx, c, out_node);
+				return out_node;
 			}
 
-			int new_prefix = prefix_idx + index;
-			Node* split_node = new Node{ pattern, new_prefix, {}};
-			assert(split_node->pattern.size() > split_node->prefix_idx);
-			split_node->mask = mask;
-			mask = 0;
-			split_node->parent = this;
-			split_node->children_num = children_num;
-			split_node->children[pattern[new_prefix] - 97] = split_node;
-			Node* out_node = this;
-			if (index < word_suffix.size())
+			// Split: the tail of the pattern moves to split_node together with the mask and children.
+			const uint32_t split_node = NewNode(node.offset, node.length, new_prefix);
+			{
+				Node& split{ nodes[split_node] };
+				Node& head{ nodes[node_idx] };
+				split.mask = head.mask;
+				split.children_mask = head.children_mask;
+				split.children = head.children;
+				split.children_num = head.children_num;
+				head.mask = 0;
+				head.length = (uint16_t)new_prefix;
+				head.children_mask = 0;
+				head.children_num = 0;
+			}
+			const string_view split_pattern{ pattern(nodes[split_node]) };
+			AddChild(node_idx, Symbol(split_pattern[new_prefix]), split_node);
+			if (index < (int)word_suffix.size())
 			{
-				out_node = new Node{ string_view{ word.data(), word.size()}, new_prefix, { } };
-				assert(out_node->pattern.size() > out_node->prefix_idx);
-				out_node->parent = this;
-				split_node->children[word[new_prefix] - 97] = out_node;
+				const uint32_t out_node = NewNode(word_offset, word.size(), new_prefix);
+				AddChild(node_idx, Symbol(word[new_prefix]), out_node);
+				return out_node;
 			}
+			return node_idx;
+		}
+	}
 
-			pattern.remove_suffix(pattern_suffix.size() - index);
-			assert(pattern.size() > prefix_idx);
+	// Renumbers nodes in depth-first order and packs the children blocks, so a subtree is one
+	// contiguous range of both arrays.
+	void Compact()
+	{
+		vector<Node> new_nodes(1);
+		new_nodes.reserve(nodes.size());
+		vector<uint32_t> new_pool;
+		new_pool.reserve(nodes.size());
 
-			for (auto& c : children)
+		auto copy_subtree = [&](auto& self, uint32_t old_idx) -> uint32_t
+		{
+			const uint32_t new_idx = (uint32_t)new_nodes.size();
+			new_nodes.push_back(nodes[old_idx]);
+			const uint32_t block = (uint32_t)new_pool.size();
+			const Node& old_node{ nodes[old_idx] };
+			new_pool.resize(block + old_node.children_num);
+			for (int i = 0; i < old_node.children_num; ++i)
 			{
-				if (c)
-				{
-					c->parent = split_node;
-				}
+				const uint32_t c = self(self, child_pool[old_node.children + i]);
+				new_pool[block + i] = c;
+			}
+			new_nodes[new_idx].children = block;
+			return new_idx;
+		};
+
+		for (auto& Root : Roots)
+		{
+			if (Root)
+			{
+				Root = copy_subtree(copy_subtree, Root);
 			}
-			swap(split_node->children, children);
-			children_num = 2;
-			return out_node;
 		}
-		return nullptr;
+		nodes = move(new_nodes);
+		child_pool = move(new_pool);
 	}
 
-	void print(int indent)
+	void Reserve(const vector<string>& words)
 	{
-		for (int i = 0; i < indent; ++i)
+		size_t text_size{ 0 };
+		for (auto& word : words)
 		{
-			cout << "---";
+			text_size += word.size();
 		}
-		cout << get_pattern() << endl;
-		for (auto& c : children)
+		text.reserve(text_size);
+		nodes.reserve(words.size() * 2);
+		child_pool.reserve(words.size() * 4);
+	}
+
+	// 1 for the words that can be on the board: the board has enough of each of their letters
+	// (FeasibleWords) and every pair and triple of consecutive letters (BoardAdjacency). Throws if
+	// the board has a byte that is not a symbol.
+	template <typename Topology>
+	static vector<uint8_t> FeasibleOnBoard(const vector<string>& words, const vector<vector<char>>& board)
+	{
+		WORDSEARCH_PROFILE_SCOPE("filter");
+		CheckBoard(board);
+		vector<uint8_t> feasible;
+		FeasibleWords(words, LetterBudget{ board }, feasible);
+		BoardAdjacency adjacency;
+		adjacency.Set<Topology>(board);
+		for (size_t i = 0; i < words.size(); ++i)
 		{
-			if (c)
+			if (feasible[i] && !adjacency.Fits(words[i]))
 			{
-				c->print(indent + 1);
+				feasible[i] = 0;
 			}
 		}
+		return feasible;
 	}
-};
 
-struct SuffixTree
-{
-	Node* Roots[26];
+	// 1 for the words to store backwards, empty for the runs rule. See Orientation.hpp.
+	template <typename Topology>
+	vector<uint8_t> Orient(const vector<string>& words, const vector<vector<char>>& board, const uint8_t* feasible) const
+	{
+		if (orientation == OrientationPolicy::Runs)
+		{
+			return {};
+		}
+		WORDSEARCH_PROFILE_SCOPE("orientation");
+		OrientationCost cost{ OrientationCost::FromBoard<Topology>(board) };
+		if (orientation == OrientationPolicy::Auto && cost.Fanout() < 1 && cost.Cells() < OrientationCost::HugeBoardCells)
+		{
+			return {};
+		}
+		return cost.Orient(words, feasible);
+	}
 
-	SuffixTree()
+	// Inserts the word in its runs orientation.
+	void Add(const string& word)
 	{
-		memset(Roots, 0, 26 * sizeof(Node*));
+		if (!word.empty())
+		{
+			Add(word, RunsReversed(word));
+		}
 	}
 
-	~SuffixTree()
+	void Add(const string& word, bool reversed)
 	{
-		for (auto& Root : Roots)
+		if (word.empty() || word.size() > UINT16_MAX || !IsSymbols(word))
 		{
-			if (Root)
+			return;
+		}
+		int mask{ 1 };
+		const uint32_t offset = (uint32_t)text.size();
+		if (reversed)
+		{
+			text.append(word.rbegin(), word.rend());
+			mask = 2;
+		}
+		else
+		{
+			text.append(word);
+		}
+		const string_view stored{ text.data() + offset, word.size() };
+		++word_count;
+		max_word_length = max(max_word_length, (uint32_t)word.size());
+
+		int idx = Symbol(stored[0]);
+		if (!Roots[idx])
+		{
+			Roots[idx] = NewNode(offset, stored.size(), 0);
+			nodes[Roots[idx]].mask = mask;
+			return;
+		}
+		// A duplicate adds its orientation, a word stored the same way again changes nothing.
+		nodes[Insert(Roots[idx], stored, offset)].mask |= mask;
+	}
+
+	// Board independent build, used by Dictionary.
+	void Build(const vector<string>& words)
+	{
+		Reserve(words);
+		{
+			WORDSEARCH_PROFILE_SCOPE("insert");
+			for (auto& word : words)
 			{
-				delete Root;
-				Root = nullptr;
+				Add(word);
 			}
 		}
+		WORDSEARCH_PROFILE_SCOPE("compact");
+		Compact();
 	}
 
-	void Build(vector<string>& words, const vector<vector<char>>& board)
+	// Only the words that can be on the board (FeasibleOnBoard), oriented by the policy, both for
+	// the adjacency of Topology. Search the tree with the same Topology: a word that only fits a
+	// wider adjacency isn't in it.
+	template <typename Topology = Orthogonal>
+	void Build(const vector<string>& words, const vector<vector<char>>& board)
 	{
-		int grid_size = board.size() * board[0].size();
-		int occ_table[26];
-		memset(occ_table, 0, 26 * sizeof(int));
-		for (auto& row : board)
+		const vector<uint8_t> feasible{ FeasibleOnBoard<Topology>(words, board) };
+		const vector<uint8_t> reversed{ Orient<Topology>(words, board, feasible.data()) };
+		Reserve(words);
+
 		{
-			for (auto& col : row)
+			WORDSEARCH_PROFILE_SCOPE("insert");
+			for (int i = 0; i < (int)words.size(); ++i)
 			{
-				++occ_table[col - 97];
+				if (feasible[i] && !words[i].empty())
+				{
+					Add(words[i], reversed.empty() ? RunsReversed(words[i]) : reversed[i]);
+				}
 			}
 		}
-		int occ[26];
-		for (int i = 0; i < words.size(); ++i)
+		WORDSEARCH_PROFILE_SCOPE("compact");
+		Compact();
+	}
+
+	// Same tree as Build, node for node, built on several threads: words are bucketed by their first
+	// stored symbol, every bucket is sorted and its subtree is built bottom-up from the sorted run,
+	// then the subtrees are laid out one after the other in symbol order. threads <= 0 uses every core.
+	void BuildParallel(const vector<string>& words, int threads = 0)
+	{
+		BuildShards(words, nullptr, nullptr, threads);
+	}
+
+	template <typename Topology = Orthogonal>
+	void BuildParallel(const vector<string>& words, const vector<vector<char>>& board, int threads = 0)
+	{
+		const vector<uint8_t> feasible{ FeasibleOnBoard<Topology>(words, board) };
+		const vector<uint8_t> reversed{ Orient<Topology>(words, board, feasible.data()) };
+		BuildShards(words, feasible.data(), reversed.empty() ? nullptr : reversed.data(), threads);
+	}
+
+	struct ShardWord
+	{
+		uint64_t key;    // first 8 stored bytes, big-endian, so most comparisons are one integer compare
+		uint32_t offset; // in text, also the insertion order
+		uint32_t word;
+		uint16_t length;
+		bool reversed;
+	};
+
+	// One root subtree in Compact() order, node and child_pool indices local to the shard.
+	struct Shard
+	{
+		vector<ShardWord> words;
+		vector<Node> nodes;
+		vector<uint32_t> pool;
+	};
+
+	// Scratch node of the sorted build. Children are a sibling list, 0 is "none".
+	struct ShardNode
+	{
+		uint32_t offset;
+		uint16_t length;
+		uint16_t prefix_idx;
+		int8_t mask;
+		uint32_t first_child;
+		uint32_t last_child;
+		uint32_t next;
+	};
+
+	void BuildShards(const vector<string>& words, const uint8_t* feasible, const uint8_t* orientations, int threads)
+	{
+		vector<Shard> shards(MaxSymbols);
+		size_t text_size{ 0 };
 		{
-			auto& word{ words[i] };
-			copy(occ_table, occ_table + 26, occ);
-			if (word.size() > grid_size)
+			WORDSEARCH_PROFILE_SCOPE("bucket");
+			for (size_t i = 0; i < words.size(); ++i)
 			{
-				continue;
+				const string& word{ words[i] };
+				if ((feasible ? !feasible[i] : !IsSymbols(word)) || word.empty() || word.size() > UINT16_MAX)
+				{
+					continue;
+				}
+				const bool reversed{ orientations ? orientations[i] != 0 : RunsReversed(word) };
+				shards[Symbol(reversed ? word.back() : word[0])].words.push_back({ 0, (uint32_t)text_size, (uint32_t)i, (uint16_t)word.size(), reversed });
+				text_size += word.size();
+				++word_count;
+				max_word_length = max(max_word_length, (uint32_t)word.size());
 			}
-			int mask{ 1 };
-			for (auto& c : word)
+			text.resize(text_size);
+		}
+
+		vector<int> order;
+		for (int c = 0; c < MaxSymbols; ++c)
+		{
+			if (!shards[c].words.empty())
+			{
+				order.push_back(c);
+			}
+		}
+		// Largest buckets first, so the long ones don't start last.
+		sort(order.begin(), order.end(), [&](int a, int b) { return shards[a].words.size() > shards[b].words.size(); });
+		if (threads <= 0)
+		{
+			threads = (int)max(1u, thread::hardware_concurrency());
+		}
+		threads = max(1, min(threads, (int)order.size()));
+
+		auto run = [&](auto&& work)
+		{
+			atomic<size_t> next{ 0 };
+			auto worker = [&]
 			{
-				if (--occ[c - 97] < 0)
+				vector<ShardNode> scratch; // per-thread arena, reused across buckets
+				for (size_t k; (k = next.fetch_add(1)) < order.size();)
 				{
-					mask = 0;
-					break;
+					work(order[k], scratch);
 				}
+			};
+			vector<thread> pool;
+			for (int t = 1; t < threads; ++t)
+			{
+				pool.emplace_back(worker);
+			}
+			worker();
+			for (auto& t : pool)
+			{
+				t.join();
+			}
+		};
+
+		{
+			WORDSEARCH_PROFILE_SCOPE("build_shards");
+			run([&](int c, vector<ShardNode>& scratch)
+			{
+				BuildShard(words, shards[c], scratch);
+			});
+		}
+
+		WORDSEARCH_PROFILE_SCOPE("merge_shards");
+		nodes.assign(1, Node{});
+		child_pool.clear();
+		memset(Roots, 0, sizeof(Roots));
+		size_t nodes_num{ 1 };
+		size_t pool_size{ 0 };
+		vector<uint32_t> node_base(MaxSymbols), pool_base(MaxSymbols);
+		for (int c = 0; c < MaxSymbols; ++c)
+		{
+			if (!shards[c].nodes.empty())
+			{
+				node_base[c] = (uint32_t)nodes_num;
+				pool_base[c] = (uint32_t)pool_size;
+				Roots[c] = node_base[c];
+				nodes_num += shards[c].nodes.size();
+				pool_size += shards[c].pool.size();
+			}
+		}
+		nodes.resize(nodes_num);
+		child_pool.resize(pool_size);
+		run([&](int c, vector<ShardNode>&)
+		{
+			Shard& shard{ shards[c] };
+			for (size_t i = 0; i < shard.nodes.size(); ++i)
+			{
+				Node& node{ nodes[node_base[c] + i] };
+				node = shard.nodes[i];
+				node.children += pool_base[c];
 			}
+			for (size_t i = 0; i < shard.pool.size(); ++i)
+			{
+				child_pool[pool_base[c] + i] = shard.pool[i] + node_base[c];
+			}
+			shard = Shard{};
+		});
+	}
 
-			if (mask == 0) continue;
+	// Builds the subtree of one bucket. Sorted words make it a single pass with a stack holding the
+	// path to the previous word: a word hangs off the deepest node on that path it shares a prefix
+	// with, splitting an edge if the prefix ends inside it. A node keeps the offset of the earliest
+	// inserted word below it and duplicates combine their orientations, as Add does.
+	void BuildShard(const vector<string>& words, Shard& shard, vector<ShardNode>& scratch)
+	{
+		char* out{ &text[0] };
+		for (ShardWord& entry : shard.words)
+		{
+			const string& word{ words[entry.word] };
+			if (entry.reversed)
+			{
+				reverse_copy(word.begin(), word.end(), out + entry.offset);
+			}
+			else
+			{
+				copy(word.begin(), word.end(), out + entry.offset);
+			}
+			for (int k = 0; k < 8; ++k)
+			{
+				entry.key = (entry.key << 8) | (k < entry.length ? uint8_t(out[entry.offset + k]) : 0);
+			}
+		}
+		auto stored = [&](const ShardWord& entry) { return string_view{ text.data() + entry.offset, entry.length }; };
+		sort(shard.words.begin(), shard.words.end(), [&](const ShardWord& a, const ShardWord& b)
+		{
+			if (a.key != b.key)
+			{
+				return a.key < b.key;
+			}
+			const int order = a.length > 8 || b.length > 8 ? stored(a).compare(stored(b)) : a.length - b.length;
+			return order != 0 ? order < 0 : a.offset < b.offset;
+		});
 
-			int left = word.find_first_not_of(word[0]);
-			int right = word.size() - word.find_last_not_of(word[word.size() - 1]);
-			if (left > right)
+		scratch.assign(1, ShardNode{});
+		auto new_node = [&](uint32_t offset, size_t length) -> uint32_t
+		{
+			scratch.push_back({ offset, (uint16_t)length, 0, 0, 0, 0, 0 });
+			return (uint32_t)scratch.size() - 1;
+		};
+		auto attach = [&](uint32_t parent, uint32_t child)
+		{
+			ShardNode& p{ scratch[parent] };
+			scratch[child].prefix_idx = p.length;
+			p.offset = min(p.offset, scratch[child].offset);
+			if (p.last_child)
+			{
+				scratch[p.last_child].next = child;
+			}
+			else
 			{
-				reverse(begin(word), end(word));
-				mask = 2;
+				p.first_child = child;
 			}
+			p.last_child = child;
+		};
 
-			int idx = word[0] - 97;
-			if (!Roots[idx])
+		vector<uint32_t> stack;
+		string_view previous;
+		for (size_t i = 0; i < shard.words.size();)
+		{
+			const string_view word{ stored(shard.words[i]) };
+			const uint32_t offset{ shard.words[i].offset };
+			int8_t mask{ 0 };
+			for (; i < shard.words.size() && stored(shard.words[i]) == word; ++i)
 			{
-				Roots[idx] = new Node{ word, 0, {} };
-				Roots[idx]->mask = mask;
-				continue;
+				mask |= shard.words[i].reversed ? 2 : 1;
 			}
-			Node* node = Roots[idx]->Insert(word);
-			if (node->mask < 3)
+
+			if (!stack.empty())
 			{
-				node->mask += mask;
+				const size_t common{ CommonPrefix(previous.data(), word.data(), min(previous.size(), word.size())) };
+				uint32_t last{ 0 };
+				while (!stack.empty() && scratch[stack.back()].length > common)
+				{
+					last = stack.back();
+					stack.pop_back();
+					if (!stack.empty() && scratch[stack.back()].length >= common)
+					{
+						attach(stack.back(), last);
+						last = 0;
+					}
+				}
+				if (last)
+				{
+					const uint32_t split = new_node(scratch[last].offset, common);
+					attach(split, last);
+					stack.push_back(split);
+				}
 			}
+			stack.push_back(new_node(offset, word.size()));
+			scratch.back().mask = mask;
+			previous = word;
+		}
+		while (stack.size() > 1)
+		{
+			const uint32_t last = stack.back();
+			stack.pop_back();
+			attach(stack.back(), last);
 		}
+
+		// Same numbering and children blocks as Compact().
+		shard.nodes.clear();
+		shard.pool.clear();
+		auto emit = [&](auto& self, uint32_t scratch_idx) -> uint32_t
+		{
+			const ShardNode& source{ scratch[scratch_idx] };
+			const uint32_t idx = (uint32_t)shard.nodes.size();
+			Node node;
+			node.offset = source.offset;
+			node.length = source.length;
+			node.prefix_idx = source.prefix_idx;
+			node.mask = source.mask;
+			shard.nodes.push_back(node);
+			const uint32_t block = (uint32_t)shard.pool.size();
+			int children_num{ 0 };
+			uint64_t children_mask{ 0 };
+			for (uint32_t child = source.first_child; child; child = scratch[child].next)
+			{
+				++children_num;
+				children_mask |= uint64_t(1) << Symbol(text[scratch[child].offset + source.length]);
+			}
+			shard.pool.resize(block + children_num);
+			int k{ 0 };
+			for (uint32_t child = source.first_child; child; child = scratch[child].next)
+			{
+				const uint32_t c = self(self, child);
+				shard.pool[block + k++] = c;
+			}
+			Node& emitted{ shard.nodes[idx] };
+			emitted.children = block;
+			emitted.children_mask = children_mask;
+			emitted.children_num = (uint8_t)children_num;
+			return idx;
+		};
+		emit(emit, stack[0]);
 	}
 
-	void print()
+	size_t memory_usage() const
+	{
+		return nodes.capacity() * sizeof(Node) + child_pool.capacity() * sizeof(uint32_t) + text.capacity();
+	}
+
+	void print(uint32_t node_idx, int indent) const
+	{
+		for (int i = 0; i < indent; ++i)
+		{
+			cout << "---";
+		}
+		const Node& node{ nodes[node_idx] };
+		cout << get_pattern(node) << endl;
+		for (int i = 0; i < node.children_num; ++i)
+		{
+			print(child_pool[node.children + i], indent + 1);
+		}
+	}
+
+	void print() const
 	{
 		for (auto& R : Roots)
 		{
 			if (R)
 			{
-				R->print(0);
+				print(R, 0);
 			}
 		}
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SuffixTree.hpp"
+#include "ParallelWordFinder.hpp"
+#include "Topology.hpp"
+#include "WordFinder.hpp"
+
+using namespace std;
+
+// Interleaves the bits of x and y, so tiles sorted by the key follow a Z-order curve and tiles
+// next to each other on the board are mostly next to each other in the order.
+inline uint64_t MortonKey(uint32_t x, uint32_t y)
+{
+    auto spread = [](uint64_t v)
+    {
+        v &= 0xffffffff;
+        v = (v | (v << 16)) & 0x0000ffff0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0f;
+        v = (v | (v << 2)) & 0x3333333333333333;
+        v = (v | (v << 1)) & 0x5555555555555555;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+// Searches huge boards tile by tile. The board is cut into tile_side x tile_side tiles and every
+// tile gets its own copy of the board around it: the tile plus a halo of max_word_length - 1 cells,
+// as far as any word starting in the tile can reach, one byte per cell and a border of zeros, so
+// neighbours are fixed offsets in the copy instead of a neighbour table per cell. A tile and its
+// copy stay in cache while its start cells are searched, and the tiles are taken in Z-order, so
+// the next tile has mostly the same letters and mostly needs the same trie nodes.
+//
+// Tiles are the unit of work for the threads. Like ParallelWordFinder the tree is not pruned:
+// found words and fully found subtrees are atomic flags per node, and the set of found words is
+// the same as for DFSWordFinder. Only for topologies without wrap-around; the tree must have been
+// built with the same Topology.
+template <typename Topology = Orthogonal>
+struct BasicTiledWordFinder
+{
+    static_assert(!Topology::Wraps, "a tile's copy has no wrap-around");
+
+    enum : uint8_t { Found = 1, Exhausted = 2 };
+
+    static constexpr int DefaultTileSide = 64;
+
+    struct NodeState
+    {
+        atomic<uint64_t> live; // children that may still have words, by symbol
+        atomic<uint8_t> flags;
+    };
+
+    struct Tile
+    {
+        int i;
+        int j;
+    };
+
+    struct Worker
+    {
+        BasicTiledWordFinder& finder;
+        vector<char> window; // tile and halo, 0 outside the board, '$' marks visited cells
+        int top{ 0 };        // board row of the first window row inside the border
+        vector<string> words;
+
+        Worker(BasicTiledWordFinder& in_finder) :
+            finder(in_finder)
+        {
+        }
+
+        void Run(const Tile& tile)
+        {
+            const vector<vector<char>>& board{ finder.board };
+            const int m = (int)board.size();
+            const int n = (int)board[0].size();
+            const int halo = finder.halo;
+            const int tile_rows = min(finder.tile_side, m - tile.i);
+            const int tile_columns = min(finder.tile_side, n - tile.j);
+            top = max(0, tile.i - halo);
+            const int left = max(0, tile.j - halo);
+            const int bottom = min(m, tile.i + tile_rows + halo);
+            const int right = min(n, tile.j + tile_columns + halo);
+            const int width = finder.width;
+            window.assign(size_t(bottom - top + 2) * width, 0);
+            for (int i = top; i < bottom; ++i)
+            {
+                copy(board[i].begin() + left, board[i].begin() + right, window.begin() + size_t(i - top + 1) * width + 1);
+            }
+
+            const SuffixTree& tree{ *finder.tree };
+            for (int i = tile.i; i < tile.i + tile_rows; ++i)
+            {
+                for (int j = tile.j; j < tile.j + tile_columns; ++j)
+                {
+                    const int cell = (i - top + 1) * width + (j - left + 1);
+                    const char letter = window[cell];
+                    if (const uint32_t root = tree.Roots[Symbol(letter)])
+                    {
+                        const Node& node{ tree.nodes[root] };
+                        window[cell] = '$';
+                        search_impl(node, tree.pattern(node), 1, cell);
+                        window[cell] = letter;
+                    }
+                }
+            }
+        }
+
+        const int* Offsets(int cell) const
+        {
+            return finder.offsets[finder.parity_offsets ? (top + cell / finder.width - 1) & 1 : 0];
+        }
+
+        // Walks the rest of the node's edge from cell. Returns true once every word below node has
+        // been reported.
+        bool search_impl(const Node& node, const string_view& node_pattern, const int idx, const int cell)
+        {
+            if (idx == (int)node_pattern.size())
+            {
+                return visit(node, idx, cell);
+            }
+
+            WORDSEARCH_COUNT(NeighborProbes);
+            const char p = node_pattern[idx];
+            const int* offsets{ Offsets(cell) };
+            for (int slot = 0; slot < Topology::Degree; ++slot)
+            {
+                const int neighbor = cell + offsets[slot];
+                if (window[neighbor] != p)
+                {
+                    continue;
+                }
+                window[neighbor] = '$';
+                const bool exhausted = search_impl(node, node_pattern, idx + 1, neighbor);
+                window[neighbor] = p;
+                WORDSEARCH_COUNT(Backtracks);
+                if (exhausted)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // At a node boundary every neighbour is probed once and its letter picks the live child,
+        // like BasicBoardWordFinder.
+        bool visit(const Node& node, const int idx, const int cell)
+        {
+            const SuffixTree& tree{ *finder.tree };
+            NodeState& state{ finder.states[&node - tree.nodes.data()] };
+            if (state.flags.load(memory_order_acquire) & Exhausted)
+            {
+                return true;
+            }
+            WORDSEARCH_COUNT(NodesVisited);
+            report(node, state);
+            const int* offsets{ Offsets(cell) };
+            for (int slot = 0; slot < Topology::Degree; ++slot)
+            {
+                const int neighbor = cell + offsets[slot];
+                const char letter = window[neighbor];
+                if (uint8_t(letter) < 'a') // border or visited; symbols past 127 are negative chars
+                {
+                    continue;
+                }
+                const uint64_t bit{ uint64_t(1) << Symbol(letter) };
+                if (!(state.live.load(memory_order_acquire) & bit))
+                {
+                    continue;
+                }
+                const Node& child{ tree.nodes[tree.child_pool[node.children + node.child_slot(Symbol(letter))]] };
+                window[neighbor] = '$';
+                const bool exhausted = search_impl(child, tree.pattern(child), idx + 1, neighbor);
+                window[neighbor] = letter;
+                WORDSEARCH_COUNT(Backtracks);
+                if (exhausted)
+                {
+                    state.live.fetch_and(~bit, memory_order_release);
+                }
+            }
+            // Children that are never next to the node's cells stay live, so the node is only
+            // exhausted once all of its children are.
+            const bool exhausted{ state.live.load(memory_order_acquire) == 0 };
+            if (exhausted)
+            {
+                state.flags.fetch_or(Exhausted, memory_order_release);
+            }
+            return exhausted;
+        }
+
+        void report(const Node& node, NodeState& state)
+        {
+            if (node.mask <= 0 || (state.flags.load(memory_order_relaxed) & Found) || (state.flags.fetch_or(Found, memory_order_acq_rel) & Found))
+            {
+                return;
+            }
+            const string_view node_pattern{ finder.tree->pattern(node) };
+            if (node.mask == 1 || node.mask == 3)
+            {
+                words.push_back(string{ node_pattern });
+                WORDSEARCH_COUNT_WORD(node_pattern.size());
+            }
+            if (node.mask >= 2)
+            {
+                words.push_back(string{ node_pattern });
+                reverse(words.back().begin(), words.back().end());
+                WORDSEARCH_COUNT_WORD(node_pattern.size());
+            }
+        }
+    };
+
+    const vector<vector<char>>& board;
+    vector<string>& out_words;
+    const SuffixTree* tree{ nullptr };
+    unique_ptr<NodeState[]> states;
+    int threads_num;
+    int tile_side;
+    int halo{ 0 };
+    int width{ 0 }; // columns of every window: the widest tile and halo and a border on both sides
+    int offsets[2][Topology::Degree]; // [board row parity][slot]: window index step, 0 for none
+    bool parity_offsets{ false };
+
+    // tile_side <= 0 uses DefaultTileSide, threads <= 0 every core.
+    BasicTiledWordFinder(const vector<vector<char>>& in_board, vector<string>& words, int in_threads_num = 0, int in_tile_side = 0) :
+        board(in_board),
+        out_words(words),
+        threads_num(in_threads_num),
+        tile_side(in_tile_side > 0 ? in_tile_side : DefaultTileSide)
+    {
+        CheckBoard(board);
+        if (threads_num <= 0)
+        {
+            threads_num = max(1u, thread::hardware_concurrency());
+        }
+    }
+
+    void FindWords(const SuffixTree& Tree)
+    {
+        WORDSEARCH_PROFILE_SCOPE("tiled_search");
+        tree = &Tree;
+        halo = max((int)Tree.max_word_length - 1, 0);
+        states.reset(new NodeState[Tree.nodes.size()]);
+        for (size_t i = 0; i < Tree.nodes.size(); ++i)
+        {
+            states[i].live.store(Tree.nodes[i].children_mask, memory_order_relaxed);
+            states[i].flags.store(0, memory_order_relaxed);
+        }
+
+        const int m = (int)board.size();
+        const int n = (int)board[0].size();
+        width = min(n, tile_side + 2 * halo) + 2;
+        SetOffsets();
+
+        vector<pair<uint64_t, Tile>> order;
+        for (int i = 0; i < m; i += tile_side)
+        {
+            for (int j = 0; j < n; j += tile_side)
+            {
+                order.push_back({ MortonKey(uint32_t(j / tile_side), uint32_t(i / tile_side)), Tile{ i, j } });
+            }
+        }
+        sort(order.begin(), order.end(), [](const pair<uint64_t, Tile>& a, const pair<uint64_t, Tile>& b) { return a.first < b.first; });
+
+        const int threads = min<int>(threads_num, (int)order.size());
+        vector<WorkStealingQueue<Tile>> queues(threads);
+        for (size_t k = 0; k < order.size(); ++k)
+        {
+            // Runs of the Z-order stay on one worker.
+            queues[k * threads / order.size()].push(order[k].second);
+        }
+
+        vector<Worker> workers;
+        workers.reserve(threads);
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back(*this);
+        }
+
+        auto work = [&](int t)
+        {
+            Tile tile;
+            while (true)
+            {
+                // The owner takes its run front to back, thieves take from the other end.
+                bool found = queues[t].steal(tile);
+                for (int k = 1; !found && k < threads; ++k)
+                {
+                    found = queues[(t + k) % threads].pop(tile);
+                }
+                if (!found)
+                {
+                    return;
+                }
+                workers[t].Run(tile);
+            }
+        };
+
+        vector<thread> pool;
+        for (int t = 1; t < threads; ++t)
+        {
+            pool.emplace_back(work, t);
+        }
+        work(0);
+        for (auto& t : pool)
+        {
+            t.join();
+        }
+
+        for (auto& worker : workers)
+        {
+            out_words.insert(out_words.end(), worker.words.begin(), worker.words.end());
+        }
+    }
+
+private:
+    // Every window has the same width, so a neighbour is the same step for every cell, or one of
+    // two for topologies like Hexagonal that depend on the parity of the board row. Neighbours are
+    // at most one row and column away, which the border of one cell covers.
+    void SetOffsets()
+    {
+        for (int parity = 0; parity < 2; ++parity)
+        {
+            const int i = 2 + parity;
+            const int j = 2;
+            for (int slot = 0; slot < Topology::Degree; ++slot)
+            {
+                int ni, nj;
+                const bool has = Topology::Neighbor(slot, i, j, 5, 5, ni, nj) && (ni != i || nj != j);
+                offsets[parity][slot] = has ? (ni - i) * width + (nj - j) : 0;
+            }
+        }
+        parity_offsets = !equal(offsets[0], offsets[0] + Topology::Degree, offsets[1]);
+    }
+};
+
+using TiledWordFinder = BasicTiledWordFinder<>;
+
+// Boards from which FindWordsAuto searches tiled. From about 24 x 24 cells on random boards the
+// tiled search, with one probe round per node boundary and exhausted children masked off, is
+// faster than the other engines even on one thread, and the gap grows with the board.
+constexpr size_t TiledBoardCells = 1024;
+
+// The tiled search for topologies without wrap-around, the plain DFS for the others.
+template <typename Topology = Orthogonal>
+void FindWordsTiled(SuffixTree& tree, const vector<vector<char>>& board, vector<string>& out, int threads = 0, int tile_side = 0)
+{
+    if constexpr (Topology::Wraps)
+    {
+        FindWordsDFS<Topology>(tree, board, out);
+    }
+    else
+    {
+        BasicTiledWordFinder<Topology> finder{ board, out, threads, tile_side };
+        finder.FindWords(tree);
+    }
+}
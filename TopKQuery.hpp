@@ -0,0 +1,367 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SuffixTree.hpp"
+#include "Dictionary.hpp"
+#include "Grids.hpp"
+#include "ResultSink.hpp"
+#include "Profiler.hpp"
+#include "Simd.hpp"
+
+using namespace std;
+
+// Word score: the sum of per-symbol scores.
+struct LetterScores
+{
+    array<int, MaxSymbols> scores;
+
+    // Every letter 1: the longest words win.
+    static LetterScores Length()
+    {
+        LetterScores letters;
+        letters.scores.fill(1);
+        return letters;
+    }
+
+    // Scrabble tile values.
+    static LetterScores Scrabble()
+    {
+        return { { 1, 3, 3, 2, 1, 4, 2, 4, 1, 8, 5, 1, 3, 1, 1, 3, 10, 1, 1, 1, 1, 4, 4, 8, 4, 10 } };
+    }
+
+    int operator()(string_view word) const
+    {
+        int score{ 0 };
+        for (char c : word)
+        {
+            score += scores[Symbol(c)];
+        }
+        return score;
+    }
+};
+
+// Best score of any word below every node of a tree, for one LetterScores. Kept beside the tree
+// rather than in Node so the node layout and the index file stay the same; build it once per tree
+// and scoring, it is read-only afterwards. The children of every node are also kept sorted by
+// bound, best first, so a search can stop at the first child that can't win.
+class ScoreBounds
+{
+public:
+    static constexpr int None = INT_MIN; // bound of a subtree without words
+
+    ScoreBounds(const TrieView& tree, const LetterScores& scores) :
+        m_scores(scores)
+    {
+        WORDSEARCH_PROFILE_SCOPE("score_bounds");
+        m_bounds.assign(tree.nodes_num, None);
+        size_t pool_size{ 0 };
+        // Children always have larger indices than their parent.
+        for (size_t i = tree.nodes_num; i-- > 1;)
+        {
+            const Node& node{ tree.nodes[i] };
+            int bound = node.mask > 0 ? scores(tree.pattern(node)) : None;
+            for (int k = 0; k < node.children_num; ++k)
+            {
+                bound = max(bound, m_bounds[tree.child_pool[node.children + k]]);
+            }
+            m_bounds[i] = bound;
+            pool_size = max<size_t>(pool_size, node.children + node.children_num);
+        }
+
+        m_children.assign(tree.child_pool, tree.child_pool + pool_size);
+        for (size_t i = 1; i < tree.nodes_num; ++i)
+        {
+            const Node& node{ tree.nodes[i] };
+            stable_sort(m_children.begin() + node.children, m_children.begin() + node.children + node.children_num,
+                [&](uint32_t a, uint32_t b) { return m_bounds[a] > m_bounds[b]; });
+        }
+
+        for (int c = 0; c < MaxSymbols; ++c)
+        {
+            m_roots[c] = tree.Roots[c];
+        }
+        stable_sort(m_roots.begin(), m_roots.end(), [&](uint32_t a, uint32_t b) { return bound(a) > bound(b); });
+    }
+
+    int bound(uint32_t node_idx) const
+    {
+        return node_idx ? m_bounds[node_idx] : None;
+    }
+
+    int score(string_view word) const
+    {
+        return m_scores(word);
+    }
+
+    // Children of the node, best bound first.
+    const uint32_t* children(const Node& node) const
+    {
+        return m_children.data() + node.children;
+    }
+
+    // Roots, best bound first, 0 for missing symbols at the end.
+    const array<uint32_t, MaxSymbols>& roots() const
+    {
+        return m_roots;
+    }
+
+private:
+    LetterScores m_scores;
+    vector<int> m_bounds;
+    vector<uint32_t> m_children; // child_pool with every block sorted by bound
+    array<uint32_t, MaxSymbols> m_roots;
+};
+
+// The k best scoring words of a board. Branch and bound over the trie: the k best so far are kept
+// in a min-heap and a subtree is skipped as soon as its bound can't beat the smallest of them.
+// Words with equal scores keep the first one found. The stamps, live masks and board filters are
+// those of BasicDictionaryQuery, so subtrees whose words are all found drop out and the children
+// left in a node's live mask are the ones its bound still counts: a board with fewer than k words
+// is done once they are found instead of walking every path again.
+template <typename Grid>
+class BasicTopKQuery
+{
+public:
+    // Reports the words best first to a sink of ResultSink.hpp. k <= 0 reports nothing.
+    template <typename Sink>
+    void FindTopWords(const TrieView& tree, const ScoreBounds& bounds, const vector<vector<char>>& board, int k, Sink&& sink)
+    {
+        WORDSEARCH_PROFILE_SCOPE("top_k_search");
+        CheckBoard(board);
+        m_tree = tree;
+        m_bounds = &bounds;
+        m_k = k;
+        m_heap.clear();
+        m_threshold = ScoreBounds::None;
+        m_paths.clear();
+        if (k <= 0)
+        {
+            return;
+        }
+        m_stamps.NextGeneration(tree.nodes_num);
+        m_live.resize(tree.nodes_num);
+        m_grid.Set(board);
+        m_filter.Set<typename Grid::GridTopology>(board);
+
+        for (auto& cells : m_cells)
+        {
+            cells.clear();
+        }
+        for (int i = 0; i < m_grid.size(); ++i)
+        {
+            if (const char c = m_grid.letter(i))
+            {
+                m_cells[Symbol(c)].push_back(i);
+            }
+        }
+
+        for (const uint32_t root_idx : bounds.roots())
+        {
+            if (bounds.bound(root_idx) <= Threshold())
+            {
+                break;
+            }
+            const Node& root{ m_tree.nodes[root_idx] };
+            if (!m_filter.Fits(m_tree, root))
+            {
+                continue;
+            }
+            const string_view root_pattern{ m_tree.pattern(root) };
+            for (int cell : m_cells[Symbol(root_pattern[0])])
+            {
+                m_path.clear();
+                m_path.push_back(cell);
+                m_grid.Visit(cell);
+                m_exhausted = false;
+                search_impl(root, root_idx, root_pattern, 1);
+                m_grid.Unvisit(cell);
+                if (m_exhausted)
+                {
+                    break;
+                }
+            }
+        }
+
+        sort(m_heap.begin(), m_heap.end(), [](const Entry& a, const Entry& b)
+        {
+            return a.score != b.score ? a.score > b.score : a.id < b.id;
+        });
+        for (const Entry& entry : m_heap)
+        {
+            ReportWords(sink, WordNode(entry.id), WordReversed(entry.id) ? 2 : 1, m_tree.pattern(m_tree.nodes[WordNode(entry.id)]),
+                m_paths.data() + entry.path, entry.length);
+        }
+    }
+
+    void FindTopWords(const Dictionary& dictionary, const ScoreBounds& bounds, const vector<vector<char>>& board, int k, vector<string>& out)
+    {
+        FindTopWords(dictionary.Tree(), bounds, board, k, StringSink{ out });
+    }
+
+    // Score of the i-th reported word of the last query.
+    int Score(size_t i) const
+    {
+        return m_heap[i].score;
+    }
+
+private:
+    struct Entry
+    {
+        int score;
+        uint32_t id;
+        uint32_t path; // offset in m_paths
+        int length;
+    };
+
+    TrieView m_tree;
+    const ScoreBounds* m_bounds{ nullptr };
+    int m_k{ 0 };
+    vector<Entry> m_heap; // min-heap on score while searching
+    vector<int> m_paths;  // board cells of every word that entered the heap
+    int m_threshold{ ScoreBounds::None }; // smallest score of a full heap
+    QueryStamps m_stamps;
+    vector<uint64_t> m_live; // children in ScoreBounds order that may still have words, valid with Live
+    Grid m_grid;
+    EdgeFilter m_filter;
+    array<vector<int>, MaxSymbols> m_cells; // cells of every symbol
+    vector<int> m_path;
+    bool m_exhausted{ false }; // whether the node visit last left is exhausted
+
+    static bool HeapOrder(const Entry& a, const Entry& b)
+    {
+        return a.score > b.score;
+    }
+
+    // Score a word has to beat to get in.
+    int Threshold() const
+    {
+        return m_threshold;
+    }
+
+    void Offer(uint32_t id, int score)
+    {
+        if (score <= Threshold())
+        {
+            return;
+        }
+        if ((int)m_heap.size() == m_k)
+        {
+            pop_heap(m_heap.begin(), m_heap.end(), HeapOrder);
+            m_heap.pop_back();
+        }
+        m_heap.push_back({ score, id, (uint32_t)m_paths.size(), (int)m_path.size() });
+        push_heap(m_heap.begin(), m_heap.end(), HeapOrder);
+        if ((int)m_heap.size() == m_k)
+        {
+            m_threshold = m_heap.front().score;
+        }
+        for (int cell : m_path)
+        {
+            m_paths.push_back(m_grid.BoardCell(cell));
+        }
+    }
+
+    // Walks the rest of the node's edge over the board while the node can still have words that
+    // make it into the heap. Exhausted nodes are only skipped in visit, the stamps are too far
+    // apart to read on every step.
+    void search_impl(const Node& node, uint32_t node_idx, const string_view& node_pattern, const int idx)
+    {
+        if (m_bounds->bound(node_idx) <= Threshold())
+        {
+            return;
+        }
+        if (idx == (int)node_pattern.size())
+        {
+            visit(node, node_idx, idx);
+            return;
+        }
+        WORDSEARCH_COUNT(NeighborProbes);
+        m_grid.ForEachNeighbor(m_path.back(), node_pattern[idx], [&](int neighbor)
+        {
+            m_grid.Visit(neighbor);
+            m_path.push_back(neighbor);
+            search_impl(node, node_idx, node_pattern, idx + 1);
+            m_path.pop_back();
+            m_grid.Unvisit(neighbor);
+            WORDSEARCH_COUNT(Backtracks);
+            return m_bounds->bound(node_idx) > Threshold();
+        });
+    }
+
+    // Offers the node's word and searches the children that can still beat the threshold. Children
+    // that are exhausted or can't be on this board are dropped from the live mask as in
+    // BasicDictionaryQuery; the node is exhausted once none are left. The words are offered on the
+    // first visit, which for a leaf is also the last.
+    void visit(const Node& node, uint32_t node_idx, const int idx)
+    {
+        if (m_stamps.Has(node_idx, QueryStamps::Exhausted))
+        {
+            m_exhausted = true;
+            return;
+        }
+        WORDSEARCH_COUNT(NodesVisited);
+        const bool first = !m_stamps.Has(node_idx, QueryStamps::Live);
+        if (first && node.mask > 0)
+        {
+            const int score = m_bounds->score(m_tree.pattern(node));
+            if (node.mask == 1 || node.mask == 3)
+            {
+                Offer(WordId(node_idx, false), score);
+            }
+            if (node.mask >= 2)
+            {
+                Offer(WordId(node_idx, true), score);
+            }
+        }
+        if (node.children_num == 0)
+        {
+            m_stamps.Set(node_idx, QueryStamps::Exhausted);
+            m_exhausted = true;
+            return;
+        }
+        // The board filters run once per child, on the first visit. Children below the threshold
+        // stay out of the mask: the threshold only goes up.
+        uint64_t& live{ m_live[node_idx] };
+        const uint32_t* children{ m_bounds->children(node) };
+        if (first)
+        {
+            m_stamps.Set(node_idx, QueryStamps::Live);
+            live = 0;
+            for (int k = 0; k < node.children_num && m_bounds->bound(children[k]) > Threshold(); ++k)
+            {
+                if (m_filter.Fits(m_tree, m_tree.nodes[children[k]]))
+                {
+                    live |= uint64_t(1) << k;
+                }
+            }
+        }
+        for (uint64_t pending = live; pending; pending &= pending - 1)
+        {
+            const int k = ctz64(pending);
+            const uint32_t child_idx = children[k];
+            if (m_bounds->bound(child_idx) <= Threshold())
+            {
+                break;
+            }
+            const Node& child{ m_tree.nodes[child_idx] };
+            m_exhausted = false;
+            search_impl(child, child_idx, m_tree.pattern(child), idx);
+            if (m_exhausted)
+            {
+                live &= ~(uint64_t(1) << k);
+            }
+        }
+        m_exhausted = live == 0;
+        if (m_exhausted)
+        {
+            m_stamps.Set(node_idx, QueryStamps::Exhausted);
+        }
+    }
+};
+
+using TopKQuery = BasicTopKQuery<CellGrid>;
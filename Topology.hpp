@@ -0,0 +1,120 @@
+#pragma once
+
+#include <utility>
+
+using namespace std;
+
+// Adjacency policies for the board engines. A topology has a fixed number of neighbour slots and
+// maps a slot of cell (i, j) on an m x n board to the neighbouring cell, or reports that there is
+// none. It is only asked while a grid is set up; the search loops run over Degree slots that are
+// known at compile time.
+//
+//   static constexpr int Degree;
+//   static constexpr bool Wraps; // neighbours across the board edges
+//   static bool Neighbor(int slot, int i, int j, int m, int n, int& ni, int& nj);
+
+inline bool OffsetCell(int i, int j, int di, int dj, int m, int n, bool wrap, int& ni, int& nj)
+{
+    ni = i + di;
+    nj = j + dj;
+    if (wrap)
+    {
+        ni = (ni + m) % m;
+        nj = (nj + n) % n;
+        return true;
+    }
+    return ni >= 0 && ni < m && nj >= 0 && nj < n;
+}
+
+// Left, right, up, down - the original adjacency.
+struct Orthogonal
+{
+    static constexpr int Degree = 4;
+    static constexpr bool Wraps = false;
+
+    static bool Neighbor(int slot, int i, int j, int m, int n, int& ni, int& nj)
+    {
+        static constexpr int offsets[Degree][2] = { { 0, -1 }, { 0, 1 }, { -1, 0 }, { 1, 0 } };
+        return OffsetCell(i, j, offsets[slot][0], offsets[slot][1], m, n, false, ni, nj);
+    }
+};
+
+// Boggle: the orthogonal neighbours followed by the diagonal ones.
+struct Diagonal
+{
+    static constexpr int Degree = 8;
+    static constexpr bool Wraps = false;
+
+    static bool Neighbor(int slot, int i, int j, int m, int n, int& ni, int& nj)
+    {
+        static constexpr int offsets[Degree][2] = {
+            { 0, -1 }, { 0, 1 }, { -1, 0 }, { 1, 0 }, { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 } };
+        return OffsetCell(i, j, offsets[slot][0], offsets[slot][1], m, n, false, ni, nj);
+    }
+};
+
+// Orthogonal with the edges wrapped around, the board is a torus.
+struct Toroidal
+{
+    static constexpr int Degree = 4;
+    static constexpr bool Wraps = true;
+
+    static bool Neighbor(int slot, int i, int j, int m, int n, int& ni, int& nj)
+    {
+        static constexpr int offsets[Degree][2] = { { 0, -1 }, { 0, 1 }, { -1, 0 }, { 1, 0 } };
+        return OffsetCell(i, j, offsets[slot][0], offsets[slot][1], m, n, true, ni, nj);
+    }
+};
+
+// Hexagonal cells in "odd-r" offset layout: odd rows are shifted half a cell to the right.
+struct Hexagonal
+{
+    static constexpr int Degree = 6;
+    static constexpr bool Wraps = false;
+
+    static bool Neighbor(int slot, int i, int j, int m, int n, int& ni, int& nj)
+    {
+        static constexpr int offsets[2][Degree][2] = {
+            { { 0, -1 }, { 0, 1 }, { -1, -1 }, { -1, 0 }, { 1, -1 }, { 1, 0 } },
+            { { 0, -1 }, { 0, 1 }, { -1, 0 }, { -1, 1 }, { 1, 0 }, { 1, 1 } } };
+        const int(&offset)[2] = offsets[i & 1][slot];
+        return OffsetCell(i, j, offset[0], offset[1], m, n, false, ni, nj);
+    }
+};
+
+// Neighbour cell ids (i * n + j) of cell (i, j), -1 for empty slots. On small wrapped boards a
+// slot can point back at the cell or repeat an earlier slot; those are emptied so a search never
+// tries the same cell twice.
+template <typename Topology>
+inline void NeighborCells(int i, int j, int m, int n, int (&out)[Topology::Degree])
+{
+    for (int slot = 0; slot < Topology::Degree; ++slot)
+    {
+        int ni, nj;
+        out[slot] = Topology::Neighbor(slot, i, j, m, n, ni, nj) ? ni * n + nj : -1;
+        if (out[slot] == i * n + j)
+        {
+            out[slot] = -1;
+        }
+        for (int k = 0; k < slot && out[slot] >= 0; ++k)
+        {
+            if (out[k] == out[slot])
+            {
+                out[slot] = -1;
+            }
+        }
+    }
+}
+
+template <typename F, int... Slots>
+inline bool ForEachSlotUnrolled(int start, F& f, integer_sequence<int, Slots...>)
+{
+    return ((Slots < start || f(Slots)) && ...);
+}
+
+// Calls f(slot) for slot = start .. Degree - 1 as straight-line code, stops when f returns false.
+template <int Degree, typename F>
+inline bool ForEachSlot(int start, F&& f)
+{
+    return ForEachSlotUnrolled(start, f, make_integer_sequence<int, Degree>{});
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "SuffixTree.hpp"
+#include "Topology.hpp"
+#include "ResultSink.hpp"
+#include "SearchLimits.hpp"
+
+using namespace std;
+
+// Smallest unsigned type that can hold Max.
+template <uint64_t Max>
+using uint_for = conditional_t<Max <= UINT8_MAX, uint8_t, conditional_t<Max <= UINT16_MAX, uint16_t, uint32_t>>;
+
+template <typename Index, int Degree>
+struct cell
+{
+    static constexpr Index None = numeric_limits<Index>::max();
+
+    char c{'0'};
+    uint8_t neighbor{0};
+    Index neighbors[Degree];
+
+    cell() : cell('0') {}
+    cell(char _c)
+        : c(_c)
+    {
+        fill(neighbors, neighbors + Degree, None);
+    }
+};
+
+// Searches the tree by walking the board and prunes found words out of it, so a tree can only be
+// searched once. MaxSide bounds both board dimensions and MaxWordLength the longest word in the
+// tree; they pick the integer types of the grid and a fixed size path, so small boards keep a
+// compact layout. 0 means unbounded: 32-bit cell ids and a path sized from the tree.
+// Topology is one of the adjacency policies in Topology.hpp, Sink one of ResultSink.hpp.
+template <int MaxSide, int MaxWordLength, typename Topology = Orthogonal, typename Sink = StringSink>
+struct BasicDFSWordFinder
+{
+    using Dim = conditional_t<MaxSide == 0, uint32_t, uint_for<MaxSide>>;
+    using Index = conditional_t<MaxSide == 0, uint32_t, uint_for<uint64_t(MaxSide) * MaxSide>>;
+    using Depth = conditional_t<(MaxWordLength > 0 && MaxWordLength <= INT8_MAX), int8_t, int>;
+    using Path = conditional_t<MaxWordLength == 0, vector<Index>, array<Index, MaxWordLength>>;
+    using Cell = cell<Index, Topology::Degree>;
+
+    Sink sink;
+    const vector<vector<char>>& board;
+    SuffixTree* tree{ nullptr };
+
+    vector<Cell> grid;
+    int grid_size;
+    Dim n;
+
+    Path path;
+    Depth path_index{ 0 };
+    SearchBudget budget;
+
+    static bool Fits(const vector<vector<char>>& board, const SuffixTree& tree)
+    {
+        return (MaxSide == 0 || (board.size() <= MaxSide && board[0].size() <= MaxSide)) &&
+            (MaxWordLength == 0 || tree.max_word_length <= MaxWordLength);
+    }
+
+    BasicDFSWordFinder(const vector<vector<char>>& in_board, Sink in_sink) :
+        sink(in_sink),
+        board(in_board)
+    {
+        CheckBoard(board);
+        assert(MaxSide == 0 || (board.size() <= MaxSide && board[0].size() <= MaxSide));
+        Dim m = (Dim)board.size();
+        n = (Dim)board[0].size();
+        grid_size = int(size_t(m) * n);
+
+        grid.resize(grid_size);
+        Index idx{ 0 };
+        int neighbors[Topology::Degree];
+        for (Dim i = 0; i < m; ++i)
+        {
+            for (Dim j = 0; j < n; ++j)
+            {
+                Cell& c{ grid[idx] };
+                c = Cell{ board[i][j] };
+                NeighborCells<Topology>(i, j, m, n, neighbors);
+                for (int k = 0; k < Topology::Degree; ++k)
+                {
+                    if (neighbors[k] >= 0)
+                    {
+                        c.neighbors[k] = (Index)neighbors[k];
+                    }
+                }
+                ++idx;
+            }
+        }
+    }
+
+    bool search_impl(Node& node)
+    {
+        int path_index_cached = path_index;
+        const string_view node_pattern{ tree->pattern(node) };
+
+        do
+        {
+            // After an early stop nothing is restored or pruned, the finder is done.
+            if (budget.Step())
+            {
+                return false;
+            }
+            if (path_index == (int)node_pattern.size())
+            {
+                WORDSEARCH_COUNT(NodesVisited);
+                if (node.mask > 0)
+                {
+                    ReportWords(sink, uint32_t(&node - tree->nodes.data()), budget.Take(node.mask), node_pattern, path.data(), path_index);
+                }
+                node.mask = -1;
+
+                for (int i = 0; i < node.children_num && !budget.Stopped();)
+                {
+                    Node& child{ tree->nodes[tree->child_pool[node.children + i]] };
+                    const int c = Symbol(tree->pattern(child)[path_index]);
+                    if (search_impl(child))
+                    {
+                        tree->RemoveChild(node, c);
+                        continue;
+                    }
+                    ++i;
+                }
+                if (budget.Stopped())
+                {
+                    return false;
+                }
+                if (!node.children_num)
+                {
+                    for (Depth i = path_index_cached; i < path_index; ++i)
+                    {
+                        grid[path[i]].c = board[path[i] / n][path[i] % n];
+                        grid[path[i]].neighbor = 0;
+                    }
+                    grid[path[path_index_cached - 1]].neighbor = 0;
+                    path_index = path_index_cached;
+                    return true;
+                }
+            }
+            else
+            {
+                WORDSEARCH_COUNT(NeighborProbes);
+                Cell* c = &grid[path[path_index - 1]];
+                const char p = node_pattern[path_index];
+                bool found{ false };
+                ForEachSlot<Topology::Degree>(c->neighbor, [&](int i)
+                {
+                    const Index neighbor_cell_index = c->neighbors[i];
+                    if (neighbor_cell_index != Cell::None)
+                    {
+                        auto& neighbor_cell{ grid[neighbor_cell_index] };
+                        if (neighbor_cell.c == p)
+                        {
+                            found = true;
+                            c->neighbor = i + 1;
+                            path[path_index] = neighbor_cell_index;
+                            neighbor_cell.c = '$';
+                            ++path_index;
+                            c = &neighbor_cell;
+                            return false;
+                        }
+                    }
+                    return true;
+                });
+                if (found)
+                {
+                    continue;
+                }
+                else
+                {
+                    c->neighbor = 0;
+                }
+            }
+            --path_index;
+            WORDSEARCH_COUNT(Backtracks);
+            if (path_index >= path_index_cached)
+            {
+                grid[path[path_index]].c = board[path[path_index] / n][path[path_index] % n];
+            }
+        } while (path_index >= path_index_cached);
+        grid[path[path_index_cached - 1]].neighbor = 0;
+        path_index = path_index_cached;
+        return false;
+    }
+
+    // Stops early at the limits, the status tells whether the words are a partial result.
+    SearchStatus FindWords(SuffixTree& Tree, const SearchLimits& limits = {})
+    {
+        WORDSEARCH_PROFILE_SCOPE("dfs_search");
+        tree = &Tree;
+        budget.Start(limits, grid_size);
+        assert(MaxWordLength == 0 || Tree.max_word_length <= MaxWordLength);
+        if constexpr (MaxWordLength == 0)
+        {
+            path.resize(max<size_t>(Tree.max_word_length, 1));
+        }
+        char cell_char;
+        for (int i = 0; i < grid_size && !budget.Stopped(); ++i)
+        {
+            cell_char = grid[i].c;
+            if (auto& Root = Tree.Roots[Symbol(cell_char)])
+            {
+                path_index = 1;
+                path[0] = i;
+                grid[i].c = '$';
+                if (search_impl(Tree.nodes[Root]))
+                {
+                    Root = 0;
+                }
+                grid[i].c = cell_char;
+            }
+            if (!budget.Stopped())
+            {
+                budget.CellSearched();
+            }
+        }
+        return budget.Status();
+    }
+
+    //void DFS(Node& Node)
+    //{
+    //    if (!SearchSuffixes(Node))
+    //    {
+    //        return;
+    //    }
+    //    for (auto& c : Node.children)
+    //    {
+    //        if (c)
+    //        {
+    //            DFS(*c);
+    //        }
+    //    }
+    //    return;
+    //}
+};
+
+using SmallDFSWordFinder = BasicDFSWordFinder<15, 32>;    // 8-bit cell ids
+using MediumDFSWordFinder = BasicDFSWordFinder<255, 64>;  // 16-bit cell ids
+using DynamicDFSWordFinder = BasicDFSWordFinder<0, 0>;
+using DFSWordFinder = DynamicDFSWordFinder;
+
+// Runs the most compact finder that can hold the board and the longest word of the tree.
+template <typename Topology = Orthogonal, typename Sink>
+SearchStatus FindWordsDFS(SuffixTree& tree, const vector<vector<char>>& board, Sink&& sink, const SearchLimits& limits = {})
+{
+    if (BasicDFSWordFinder<15, 32, Topology, Sink&>::Fits(board, tree))
+    {
+        BasicDFSWordFinder<15, 32, Topology, Sink&> finder{ board, sink };
+        return finder.FindWords(tree, limits);
+    }
+    else if (BasicDFSWordFinder<255, 64, Topology, Sink&>::Fits(board, tree))
+    {
+        BasicDFSWordFinder<255, 64, Topology, Sink&> finder{ board, sink };
+        return finder.FindWords(tree, limits);
+    }
+    else
+    {
+        BasicDFSWordFinder<0, 0, Topology, Sink&> finder{ board, sink };
+        return finder.FindWords(tree, limits);
+    }
+}
+
+template <typename Topology = Orthogonal>
+SearchStatus FindWordsDFS(SuffixTree& tree, const vector<vector<char>>& board, vector<string>& out, const SearchLimits& limits = {})
+{
+    return FindWordsDFS<Topology>(tree, board, StringSink{ out }, limits);
+}
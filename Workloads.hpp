@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Seeded board and dictionary generators for the demo and the benchmark suite. The same seed always
+// gives the same workload, so results can be compared between builds.
+
+// Letter weights for random boards and words. Uniform keeps the plain rng() % 26 draw.
+struct LetterDistribution
+{
+    vector<double> weights; // empty - uniform
+
+    static LetterDistribution Uniform()
+    {
+        return {};
+    }
+
+    // Relative letter frequencies of English text.
+    static LetterDistribution English()
+    {
+        return { { 8.2, 1.5, 2.8, 4.3, 12.7, 2.2, 2.0, 6.1, 7.0, 0.15, 0.77, 4.0, 2.4,
+                   6.7, 7.5, 1.9, 0.095, 6.0, 6.3, 9.1, 2.8, 0.98, 2.4, 0.15, 2.0, 0.074 } };
+    }
+
+    // The first `letters` letters of the alphabet, equally likely. Past 26 they are the symbols of
+    // a larger alphabet (Alphabet.hpp), up to MaxSymbols.
+    static LetterDistribution FirstLetters(int letters)
+    {
+        LetterDistribution distribution;
+        distribution.weights.assign(max(letters, 26), 0);
+        for (int i = 0; i < letters; ++i)
+        {
+            distribution.weights[i] = 1;
+        }
+        return distribution;
+    }
+};
+
+class LetterSampler
+{
+public:
+    LetterSampler(const LetterDistribution& distribution) :
+        m_uniform(distribution.weights.empty()),
+        m_letters(m_uniform ? discrete_distribution<int>{} : discrete_distribution<int>(distribution.weights.begin(), distribution.weights.end()))
+    {
+    }
+
+    char operator()(mt19937& rng)
+    {
+        return char('a' + (m_uniform ? rng() % 26 : m_letters(rng)));
+    }
+
+private:
+    bool m_uniform;
+    discrete_distribution<int> m_letters;
+};
+
+inline vector<vector<char>> RandomBoard(int m, int n, unsigned seed, const LetterDistribution& distribution = LetterDistribution::Uniform())
+{
+    mt19937 rng{ seed };
+    LetterSampler letter{ distribution };
+    vector<vector<char>> board(m, vector<char>(n));
+    for (auto& row : board)
+    {
+        for (char& c : row)
+        {
+            c = letter(rng);
+        }
+    }
+    return board;
+}
+
+// Every cell the same letter: every path matches, the worst case for the search.
+inline vector<vector<char>> SingleLetterBoard(int m, int n, char letter = 'a')
+{
+    return vector<vector<char>>(m, vector<char>(n, letter));
+}
+
+// Checkerboard of two letters.
+inline vector<vector<char>> TwoLetterBoard(int m, int n, char a = 'a', char b = 'b')
+{
+    vector<vector<char>> board(m, vector<char>(n));
+    for (int i = 0; i < m; ++i)
+    {
+        for (int j = 0; j < n; ++j)
+        {
+            board[i][j] = (i + j) % 2 ? a : b;
+        }
+    }
+    return board;
+}
+
+// Single letter board with the other letters along the top row, the left column and then the
+// bottom row (the commented-out 12x12 demo board), so words ending in them are only found after a
+// long walk through the 'a's.
+inline vector<vector<char>> FramedSingleLetterBoard(int side)
+{
+    vector<vector<char>> board{ SingleLetterBoard(side, side) };
+    char letter = 'b';
+    for (int j = 1; j < side && letter <= 'z'; ++j)
+    {
+        board[0][j] = letter++;
+    }
+    for (int i = 0; i < side && letter <= 'z'; ++i)
+    {
+        board[i][0] = letter++;
+    }
+    for (int j = 1; j < side && letter <= 'z'; ++j)
+    {
+        board[side - 1][j] = letter++;
+    }
+    return board;
+}
+
+// Words spelled by random self-avoiding walks over the board, so they can all be found.
+inline vector<string> RandomWalkWords(const vector<vector<char>>& board, int count, int min_length, int max_length, unsigned seed)
+{
+    mt19937 rng{ seed };
+    const int m = (int)board.size();
+    const int n = (int)board[0].size();
+    const int di[4] = { 0, 0, -1, 1 };
+    const int dj[4] = { -1, 1, 0, 0 };
+    vector<string> words;
+    set<pair<int, int>> visited;
+    // Boards too small for min_length would never finish.
+    for (long long attempts = 0; (int)words.size() < count && attempts < 100ll * count; ++attempts)
+    {
+        const int length = min_length + rng() % (max_length - min_length + 1);
+        int i = rng() % m;
+        int j = rng() % n;
+        string word{ board[i][j] };
+        visited = { { i, j } };
+        while ((int)word.size() < length)
+        {
+            const int d = rng() % 4;
+            const int ni = i + di[d];
+            const int nj = j + dj[d];
+            if (ni < 0 || ni >= m || nj < 0 || nj >= n || !visited.insert({ ni, nj }).second)
+            {
+                if (visited.size() > 1 && rng() % 8 == 0)
+                {
+                    break;
+                }
+                continue;
+            }
+            i = ni;
+            j = nj;
+            word += board[i][j];
+        }
+        if ((int)word.size() >= min_length)
+        {
+            words.push_back(word);
+        }
+    }
+    return words;
+}
+
+inline vector<string> RandomWords(int count, int min_length, int max_length, unsigned seed, const LetterDistribution& distribution = LetterDistribution::Uniform())
+{
+    mt19937 rng{ seed };
+    LetterSampler letter{ distribution };
+    vector<string> words(count);
+    for (auto& word : words)
+    {
+        word.resize(min_length + rng() % (max_length - min_length + 1));
+        for (char& c : word)
+        {
+            c = letter(rng);
+        }
+    }
+    return words;
+}
+
+// Dictionary built from a few long stems with short random endings, so most words share a long
+// prefix. Stresses edge splits in Build and long common-prefix compares.
+inline vector<string> SharedPrefixWords(int count, int stems, int stem_length, int max_suffix, unsigned seed, const LetterDistribution& distribution = LetterDistribution::Uniform())
+{
+    const vector<string> prefixes{ RandomWords(stems, stem_length, stem_length, seed, distribution) };
+    mt19937 rng{ seed + 1 };
+    LetterSampler letter{ distribution };
+    vector<string> words(count);
+    for (auto& word : words)
+    {
+        const string& stem{ prefixes[rng() % stems] };
+        // Any prefix of the stem, then the ending.
+        word = stem.substr(0, stem_length / 2 + rng() % (stem_length - stem_length / 2 + 1));
+        const int suffix = 1 + rng() % max_suffix;
+        for (int i = 0; i < suffix; ++i)
+        {
+            word += letter(rng);
+        }
+    }
+    return words;
+}
+
+// prefix followed by every two letter ending. PrefixedPairWords("abababab") is the dictionary of
+// the demo board, PrefixedPairWords("aaaaaaaa") the one of the commented-out single letter case:
+// all 676 words share the whole prefix.
+inline vector<string> PrefixedPairWords(const string& prefix)
+{
+    vector<string> words;
+    for (char a = 'a'; a <= 'z'; ++a)
+    {
+        for (char b = 'a'; b <= 'z'; ++b)
+        {
+            words.push_back(prefix + a + b);
+        }
+    }
+    return words;
+}
@@ -0,0 +1,12 @@
+# Merges Clang's raw profiles from a pgo-train run into PROFILE_DIR/wordsearch.profdata.
+#   cmake -DPROFDATA=<llvm-profdata> -DPROFILE_DIR=<dir> -P MergeProfiles.cmake
+
+file(GLOB raw_profiles ${PROFILE_DIR}/*.profraw)
+if(NOT raw_profiles)
+    message(FATAL_ERROR "No raw profiles in ${PROFILE_DIR}")
+endif()
+execute_process(COMMAND ${PROFDATA} merge -output=${PROFILE_DIR}/wordsearch.profdata ${raw_profiles}
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "llvm-profdata merge failed")
+endif()